@@ -1,53 +1,102 @@
+#ifndef BezierCurve_DEFINED
+#define BezierCurve_DEFINED
+
 #include "./include/GPoint.h"
 #include <cmath>
 
-extern float tolerance = 0.25;
+/**
+ * A quadratic Bezier in power form, P(t) = A t^2 + B t + C.
+ *
+ * Flattening walks it with forward differences: after begin(steps), each
+ * next() returns the following point for two additions, with no pow() and
+ * no virtual calls.
+ */
+class QuadBezierCurve {
+public:
+    QuadBezierCurve(const GPoint pts[3]) {
+        A = pts[0] - 2 * pts[1] + pts[2];
+        B = 2 * (pts[1] - pts[0]);
+        C = pts[0];
+    }
 
-class BezierCurve {
-public: 
-    virtual void setControlPoints(const GPoint[]) = 0;
-    virtual GPoint eval(float) = 0;
-};
+    GPoint eval(float t) const {
+        return (A * t + B) * t + C;
+    }
 
-class QuadBezierCurve : public BezierCurve {
-public:
-    void setControlPoints(const GPoint pts[]) override {
-        for (int i = 0; i < 3; i ++) {
-            cpts[i] = pts[i];
-        }
+    /**
+     * @brief Start stepping from t = 0 in steps of 1 / steps.
+     */
+    void begin(int steps) {
+        float h = 1.0f / steps;
+        curr = C;
+        d1 = A * (h * h) + B * h;
+        d2 = A * (2 * h * h);
     }
-    
-    GPoint eval(float t) override {
-        return cpts[0] * pow((1 - t), 2) + 2 * cpts[1] * t * (1 - t) + cpts[2] * pow(t, 2);
+
+    /**
+     * @brief Point at the next step.
+     */
+    GPoint next() {
+        curr += d1;
+        d1 += d2;
+        return curr;
     }
 
 private:
-    GPoint cpts[3];
+    GPoint A, B, C;
+    GPoint curr, d1, d2; // point, first and second differences
 };
 
-class CubicBezierCurve : public BezierCurve {
+/**
+ * A cubic Bezier in power form, P(t) = A t^3 + B t^2 + C t + D,
+ * flattened by forward differencing like QuadBezierCurve.
+ */
+class CubicBezierCurve {
 public:
-    void setControlPoints(const GPoint pts[]) override {
-        for (int i = 0; i < 4; i ++) {
-            cpts[i] = pts[i];
-        }
+    CubicBezierCurve(const GPoint pts[4]) {
+        A = pts[3] - pts[0] + 3 * (pts[1] - pts[2]);
+        B = 3 * (pts[0] - 2 * pts[1] + pts[2]);
+        C = 3 * (pts[1] - pts[0]);
+        D = pts[0];
     }
-    
-    GPoint eval(float t) override {
-        return cpts[0] * pow((1 - t), 3) 
-            + 3 * cpts[1] * t * pow((1 - t), 2) 
-            + 3 * cpts[2] * (1 - t) * pow(t, 2)
-            + pow(t, 3) * cpts[3];
+
+    GPoint eval(float t) const {
+        return ((A * t + B) * t + C) * t + D;
+    }
+
+    /**
+     * @brief Start stepping from t = 0 in steps of 1 / steps.
+     */
+    void begin(int steps) {
+        float h = 1.0f / steps;
+        float h2 = h * h;
+        float h3 = h2 * h;
+        curr = D;
+        d1 = A * h3 + B * h2 + C * h;
+        d2 = A * (6 * h3) + B * (2 * h2);
+        d3 = A * (6 * h3);
+    }
+
+    /**
+     * @brief Point at the next step.
+     */
+    GPoint next() {
+        curr += d1;
+        d1 += d2;
+        d2 += d3;
+        return curr;
     }
 
 private:
-    GPoint cpts[4];
+    GPoint A, B, C, D;
+    GPoint curr, d1, d2, d3; // point, first, second and third differences
 };
 
 // Cubic Test data:
 // GPoint pts1[] = {GPoint({-1, 4}), GPoint({-1, 2}), GPoint({7, 2}), GPoint({7, 6})};
-// CubicBezierCurve cbc;
-// cbc.setControlPoints(pts1);
+// CubicBezierCurve cbc(pts1);
 // GPoint ans1 = cbc.eval(0.1); // (-0.776, 3.462)
 // GPoint ans1 = cbc.eval(0.5); // (3, 2.75)
-// https://www.desmos.com/calculator/ebdtbxgbq0
\ No newline at end of file
+// https://www.desmos.com/calculator/ebdtbxgbq0
+
+#endif
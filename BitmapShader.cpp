@@ -5,6 +5,7 @@
 #include "./include/GMatrix.h"
 #include "./include/GBitmap.h"
 #include "./include/GPoint.h"
+#include "./GRasterPipeline.h"
 
 /// @brief A bitmap shader.
 class BitmapShader : public GShader {
@@ -19,78 +20,24 @@ public:
         GMatrix inv_ctm;
         if (!ctm.invert(&inv_ctm)) return false;
         m = GMatrix::Concat(localInverse, inv_ctm);
+        pipelineBitmap = {ShaderBM.pixels(), (int)(ShaderBM.rowBytes() >> 2),
+                          ShaderBM.width(), ShaderBM.height(), &m};
+        rowPipeline = GRasterPipeline();
+        appendStages(&rowPipeline);
         return true;
     }
 
     void shadeRow(int x, int y, int count, GPixel row[]) {
-        GPoint tmp = m * GPoint{x + 0.5f, y + 0.5f};
-        float localX = tmp.fX;
-        float localY = tmp.fY;
-        float dx = m[0];
-        float dy = m[3];
-        for (int j = 0; j < count; j ++) {
-            float ix = localX + dx * j;
-            float iy = localY + dy * j;
-
-            // Clamp
-            switch(mode) {
-                case GShader::kClamp: {
-                    if (ix >= ShaderBM.width()) {
-                        ix = ShaderBM.width() - 1;
-                    } else if (ix < 0) ix = 0;
-                    
-                    if (iy >= ShaderBM.height()) {
-                        iy = ShaderBM.height() - 1;
-                    } else if (iy < 0) iy = 0;
-                    break;
-                }
-                case GShader::kRepeat: {
-                    ix = ix / ShaderBM.width();
-                    iy = iy / ShaderBM.height();
-                    ix = ix - floor(ix);
-                    iy = iy - floor(iy);
-                    ix = ix * ShaderBM.width();
-                    iy = iy * ShaderBM.height();
-                    if (ix > ShaderBM.width() - 1) {
-                        ix = ShaderBM.width() - 1;
-                    }
-                    if (iy > ShaderBM.height() - 1) {
-                        iy = ShaderBM.height() - 1;
-                    }
-                    assert(ix < ShaderBM.width());
-                    assert(iy < ShaderBM.height()); 
-                    break;
-                }
-                case GShader::kMirror: {
-                    ix = ix / (2 * ShaderBM.width());
-                    iy = iy / (2 * ShaderBM.height());
-                    ix = ix - floor(ix);
-                    iy = iy - floor(iy);
-                    if (ix <= 0.5) ix = ix * 2 * ShaderBM.width();
-                    else {
-                        float diff = ix - 0.5;
-                        ix = (0.5 - diff) * 2 * ShaderBM.width();
-                    }
+        rowPipeline.shadeRow(x, y, count, row);
+    }
 
-                    if (iy <= 0.5) iy = iy * 2 * ShaderBM.height();
-                    else {
-                        float diff = iy - 0.5;
-                        iy = (0.5 - diff) * 2 * ShaderBM.height(); 
-                    }
-                    
-                    if (ix > ShaderBM.width() - 1) {
-                        ix = ShaderBM.width() - 1;
-                    }
-                    if (iy > ShaderBM.height() - 1) {
-                        iy = ShaderBM.height() - 1;
-                    }
-                    assert(ix < ShaderBM.width());
-                    assert(iy < ShaderBM.height()); 
-                    break;
-                }
-            }
-            row[j] = *ShaderBM.getAddr(ix, iy);
+    bool appendStages(GRasterPipeline* p) override {
+        switch (mode) {
+            case GShader::kClamp:  p->append(GRasterPipeline::kBitmapClamp, &pipelineBitmap);  break;
+            case GShader::kRepeat: p->append(GRasterPipeline::kBitmapRepeat, &pipelineBitmap); break;
+            case GShader::kMirror: p->append(GRasterPipeline::kBitmapMirror, &pipelineBitmap); break;
         }
+        return true;
     }
 
 private:
@@ -98,6 +45,8 @@ private:
     GMatrix localInverse;
     GBitmap ShaderBM;
     GShader::TileMode mode;
+    GPipelineBitmap pipelineBitmap;
+    GRasterPipeline rowPipeline;  // just the stages above, for shadeRow
 };
 
 
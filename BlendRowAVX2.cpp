@@ -0,0 +1,58 @@
+#include "./GBlendRowSimd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+// Everything from here on may use AVX2; Only ever reached through GCpuHasAVX2()
+#pragma GCC target("avx2")
+
+#include <immintrin.h>
+
+namespace {
+
+/// @brief Eight pixels per __m256i; See GBlendRowKernels.h for what each operation does.
+struct AVX2 {
+    typedef __m256i Vec;
+    enum { N = 8 };
+
+    static Vec load(const uint32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(uint32_t* p, Vec v) { _mm256_storeu_si256((__m256i*)p, v); }
+    static Vec splat(uint32_t pixel) { return _mm256_set1_epi32((int)pixel); }
+
+    static Vec coverage(const uint8_t* bytes) {
+        return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)bytes));
+    }
+
+    static Vec add(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+    static Vec alpha(Vec v) { return _mm256_srli_epi32(v, 24); }
+    static Vec inv(Vec a) { return _mm256_sub_epi32(_mm256_set1_epi32(255), a); }
+
+    static Vec mul(Vec v, Vec a) {
+        // The unpacks and the pack work within each 128-bit half, so they line up
+        __m256i zero = _mm256_setzero_si256();
+        __m256i a2 = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+        __m256i lo = mulHalf(_mm256_unpacklo_epi8(v, zero), _mm256_unpacklo_epi32(a2, a2));
+        __m256i hi = mulHalf(_mm256_unpackhi_epi8(v, zero), _mm256_unpackhi_epi32(a2, a2));
+        return _mm256_packus_epi16(lo, hi);
+    }
+
+    /// @brief div255(x * a) for 16-bit lanes: (t * 257) >> 16 with t = x * a + 128.
+    static __m256i mulHalf(__m256i x, __m256i a) {
+        __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, a), _mm256_set1_epi16(128));
+        return _mm256_mulhi_epu16(t, _mm256_set1_epi16(257));
+    }
+};
+
+} // namespace
+
+#include "./GBlendRowKernels.h"
+
+int GBlendRowAVX2(GBlendMode mode, uint32_t* dst, const uint32_t* src, bool srcIsRow, const uint8_t* coverage,
+                  int count) {
+    return blendRowVec<AVX2>(mode, dst, src, srcIsRow, coverage, count);
+}
+
+#else
+
+int GBlendRowAVX2(GBlendMode, uint32_t*, const uint32_t*, bool, const uint8_t*, int) { return 0; }
+
+#endif
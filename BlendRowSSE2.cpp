@@ -0,0 +1,107 @@
+#include "./GBlendRowSimd.h"
+
+#if defined(__SSE2__) && defined(__GNUC__)
+
+#include <emmintrin.h>
+#include <string.h>
+
+namespace {
+
+/// @brief Four pixels per __m128i; See GBlendRowKernels.h for what each operation does.
+struct SSE2 {
+    typedef __m128i Vec;
+    enum { N = 4 };
+
+    static Vec load(const uint32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(uint32_t* p, Vec v) { _mm_storeu_si128((__m128i*)p, v); }
+    static Vec splat(uint32_t pixel) { return _mm_set1_epi32((int)pixel); }
+
+    static Vec coverage(const uint8_t* bytes) {
+        int four;
+        memcpy(&four, bytes, 4);
+        __m128i zero = _mm_setzero_si128();
+        return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(four), zero), zero);
+    }
+
+    static Vec add(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+    static Vec alpha(Vec v) { return _mm_srli_epi32(v, 24); }
+    static Vec inv(Vec a) { return _mm_sub_epi32(_mm_set1_epi32(255), a); }
+
+    static Vec mul(Vec v, Vec a) {
+        // Widen the channels to 16 bits, and copy each pixel's factor to its 4 channels
+        __m128i zero = _mm_setzero_si128();
+        __m128i a2 = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+        __m128i lo = mulHalf(_mm_unpacklo_epi8(v, zero), _mm_unpacklo_epi32(a2, a2));
+        __m128i hi = mulHalf(_mm_unpackhi_epi8(v, zero), _mm_unpackhi_epi32(a2, a2));
+        return _mm_packus_epi16(lo, hi);
+    }
+
+    /// @brief div255(x * a) for 16-bit lanes: (t * 257) >> 16 with t = x * a + 128.
+    static __m128i mulHalf(__m128i x, __m128i a) {
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+        return _mm_mulhi_epu16(t, _mm_set1_epi16(257));
+    }
+};
+
+} // namespace
+
+#include "./GBlendRowKernels.h"
+
+int GBlendRowSSE2(GBlendMode mode, uint32_t* dst, const uint32_t* src, bool srcIsRow, const uint8_t* coverage,
+                  int count) {
+    return blendRowVec<SSE2>(mode, dst, src, srcIsRow, coverage, count);
+}
+
+bool GCpuHasAVX2() {
+    // Static initializers may run before the CPU model is set up, so set it up first
+    static const bool hasAVX2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return hasAVX2;
+}
+
+static GBlendRowSimdProc chooseBlendRowSimd() {
+    return GCpuHasAVX2() ? GBlendRowAVX2 : GBlendRowSSE2;
+}
+
+void GFillRow(uint32_t* dst, uint32_t pixel, size_t count, bool streaming) {
+    __m128i v = _mm_set1_epi32((int)pixel);
+    if (streaming) {
+        // Non-temporal stores must be aligned; Pixels are, so at most 3 are stored first one by one
+        for (; count > 0 && ((uintptr_t)dst & 15) != 0; count --) {
+            *dst++ = pixel;
+        }
+        for (; count >= 16; count -= 16, dst += 16) {
+            _mm_stream_si128((__m128i*)dst, v);
+            _mm_stream_si128((__m128i*)(dst + 4), v);
+            _mm_stream_si128((__m128i*)(dst + 8), v);
+            _mm_stream_si128((__m128i*)(dst + 12), v);
+        }
+        // Order the streamed stores before any later store, e.g. by another thread
+        _mm_sfence();
+    }
+    for (; count >= 4; count -= 4, dst += 4) {
+        _mm_storeu_si128((__m128i*)dst, v);
+    }
+    for (; count > 0; count --) {
+        *dst++ = pixel;
+    }
+}
+
+#else
+
+int GBlendRowSSE2(GBlendMode, uint32_t*, const uint32_t*, bool, const uint8_t*, int) { return 0; }
+
+bool GCpuHasAVX2() { return false; }
+
+static GBlendRowSimdProc chooseBlendRowSimd() {
+    return GBlendRowSSE2;
+}
+
+void GFillRow(uint32_t* dst, uint32_t pixel, size_t count, bool) {
+    for (size_t i = 0; i < count; i ++) {
+        dst[i] = pixel;
+    }
+}
+
+#endif
+
+const GBlendRowSimdProc gBlendRowSimd = chooseBlendRowSimd();
@@ -13,27 +13,45 @@
 #include "./include/GRect.h"
 #include <vector>
 #include <stack>
+#include <unordered_map>
 #include "./GEdge.h"
-#include "./GBlenders.h"
+#include "./GCoverage.h"
+#include "./GSpan.h"
+#include "./GBlitter.h"
+#include "./GThreadPool.h"
+#include "./GEdgeCache.h"
+#include "./GArena.h"
+#include "./GClipMask.h"
+#include "./GQuadLevel.h"
 #include "./BezierCurve.h"
-#include "./TriangleShaders.h"
 
 using namespace std;
 
+// Edge lists each canvas keeps for drawPath
+static const int kDefaultPathCacheLimit = 64;
+
 class Canvas : public GCanvas {
 public:
-    Canvas(const GBitmap& bitmap) : fDevice(bitmap), blenders(Blenders()) {
+    Canvas(const GBitmap& bitmap, int threadCount = 1) : fDevice(bitmap),
+        pool(threadCount), drawDepth(0),
+        edgeCache(kDefaultPathCacheLimit), segmentCache(kDefaultPathCacheLimit) {
         matrixStack.push(GMatrix());
+        clipStack.push(ClipState({GIRect::WH(bitmap.width(), bitmap.height()), nullptr}));
+        for (int i = 0; i < threadCount; i ++) {
+            arenas.emplace_back(new GArena(kArenaBytesPerColumn * bitmap.width()));
+        }
     }
 
     /////////////////////////////////////////////////////////////////////////// 
-    // Matrix stack operations
+    // Matrix and clip stack operations
     void save() {
         matrixStack.push(matrixStack.top()); 
+        clipStack.push(clipStack.top());
     }
 
     void restore() {
         matrixStack.pop();
+        clipStack.pop();
     }
 
     void concat(const GMatrix& matrix) {
@@ -42,33 +60,129 @@ public:
         matrixStack.pop();
         matrixStack.push(newTop);
     }
+
+    /// @brief Intersect the clip with a rect under the CTM.
+    /// A rect that stays axis-aligned only shrinks the clip bounds, which spans are
+    /// trimmed to for free; Any other is clipped as a path.
+    void clipRect(const GRect& rect) override {
+        const GMatrix& ctm = matrixStack.top();
+        if (ctm[1] != 0 || ctm[3] != 0) {
+            GPath path;
+            path.addRect(rect);
+            clipPath(path, false);
+            return;
+        }
+        ClipState& clip = clipStack.top();
+        clip.bounds = intersect(clip.bounds, deviceRect(rect));
+    }
+
+    /// @brief Intersect the clip with a path under the CTM.
+    /// The path is rasterized into an A8 mask over the new clip bounds, and combined
+    /// with the mask of the clip so far; The blit stage then scales coverage by it.
+    /// @param antiAlias Whether the mask gets the path's partial coverage along its edges.
+    void clipPath(const GPath& path, bool antiAlias) override {
+        ScratchScope scope(*this);
+        ClipState& clip = clipStack.top();
+        if (path.countPoints() == 0) {
+            clip.bounds = GIRect::LTRB(0, 0, 0, 0);
+            return;
+        }
+        GPath device = devicePath(path);
+        GIRect bounds = intersect(clip.bounds, roundOut(device.bounds()));
+        if (bounds.isEmpty()) {
+            clip.bounds = GIRect::LTRB(0, 0, 0, 0);
+            return;
+        }
+
+        std::shared_ptr<GClipMask> mask = std::make_shared<GClipMask>(bounds);
+        auto write = [&](const GSpanList& spans) {
+            for (const GSpan& span : spans.getSpans()) {
+                uint8_t* dst = mask->getAddr(span.x, span.y);
+                if (span.coverage < 0) {
+                    memset(dst, 255, span.count);
+                } else {
+                    memcpy(dst, spans.getCoverage(span), span.count);
+                }
+            }
+        };
+        clip.bounds = bounds; // The spans written are trimmed to the mask
+        bool needsClip = (testBounds(device.bounds()) == kStraddles);
+        if (antiAlias) {
+            GArenaVector<GSegment> segments(scratch());
+            assembleEdges(path, matrixStack.top(), needsClip, segments);
+            sortSegments(segments);
+            fillSegmentsAA(segments, write);
+        } else {
+            GArenaVector<GEdge> edges(scratch());
+            assembleEdges(path, matrixStack.top(), needsClip, edges);
+            fillEdgesWinding(edges, write);
+        }
+
+        if (clip.mask) {
+            for (int y = bounds.fTop; y < bounds.fBottom; y ++) {
+                uint8_t* dst = mask->getAddr(bounds.fLeft, y);
+                const uint8_t* prev = clip.mask->getAddr(bounds.fLeft, y);
+                for (int i = 0; i < bounds.width(); i ++) {
+                    dst[i] = Blenders::div255(dst[i] * prev[i]);
+                }
+            }
+        }
+        clip.mask = mask;
+    }
+
     ///////////////////////////////////////////////////////////////////////////////////////////////
     // Draw calls
     
     /// @brief Draw triangle meshes based upon the provided payload.
+    /// Vertices are transformed once for the whole mesh, and each triangle is
+    /// walked like a convex polygon and shaded from plane equations, with no
+    /// per-triangle shader objects or allocations.
     /// @param verts List of vertices coordinates.
     /// @param colors List of colors; Could be null if no color is used.
     /// @param texs List of texture UV; Could be null if no texture is used.
     /// @param count Number of triangles.
     /// @param indices List of indices into the payload arrays.
-    /// @param textureShader The texture provider, if texture is used.
+    /// @param paint Its shader provides the texture, if texture is used.
     void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
-                          int count, const int indices[], const GPaint& textureShader) override 
+                          int count, const int indices[], const GPaint& paint) override 
     {
-        bool hasColor = colors != nullptr;
-        bool hasTex = texs != nullptr;
-        if (!hasColor && !hasTex) {
-            return;
-        } else if (hasColor && !hasTex) {
-            drawColorMesh(verts, colors, count, indices);
-        } else if (!hasColor && hasTex) {
-            drawTexMesh(verts, texs, count, indices, textureShader);
-        } else {
-            drawColorTexMesh(verts, colors, texs, count, indices, textureShader);
+        ScratchScope scope(*this);
+        GShader* texShader = texs != nullptr ? paint.getShader() : nullptr;
+        if (count <= 0 || (colors == nullptr && texShader == nullptr)) return;
+
+        int vertCount = 0;
+        for (int i = 0; i < 3 * count; i ++) {
+            vertCount = std::max(vertCount, indices[i] + 1);
+        }
+        GPoint* deviceVerts = scratch().alloc<GPoint>(vertCount);
+        matrixStack.top().mapPoints(deviceVerts, verts, vertCount);
+
+        MeshBlit blit = beginMesh(colors != nullptr, texShader, paint);
+        if (blit.blitter.isNoOp()) return;
+        if (texShader == nullptr && pool.threadCount() > 1) {
+            GArenaVector<MeshBlit> threadBlits = perThreadMeshBlits(blit);
+            if (drawMeshBinned(threadBlits, deviceVerts, colors, count, indices)) return;
+        }
+        for (int i = 0; i < 3 * count; i += 3) {
+            int i0 = indices[i], i1 = indices[i + 1], i2 = indices[i + 2];
+            const GPoint pts[3] = {deviceVerts[i0], deviceVerts[i1], deviceVerts[i2]};
+            GColor c[3];
+            GPoint t[3];
+            if (colors != nullptr) {
+                c[0] = colors[i0]; c[1] = colors[i1]; c[2] = colors[i2];
+            }
+            if (texShader != nullptr) {
+                t[0] = texs[i0]; t[1] = texs[i1]; t[2] = texs[i2];
+            }
+            drawMeshTriangle(blit, pts, c, t);
         }
     }
 
     /// @brief Draw a quad mesh based upon the provided payload.
+    /// The quad is divided into (level + 1) * (level + 1) sub-quads of two triangles
+    /// each. Grids up to kMaxQuadGridVerts are written into scratch memory and
+    /// drawn with the cached index topology of their level; Larger ones are streamed
+    /// two rows at a time, so they never hold the whole grid.
     /// @param verts List of vertices coordinates.
     /// @param colors List of colors; Could be null if no color is used.
     /// @param texs List of texture UV; Could be null if no texture is used.
@@ -77,64 +191,59 @@ public:
     void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
                           int level, const GPaint& paint)
     {
-        GPoint** i_vertices = bilinearInterpolatePayload(verts, level);
-        GPoint** i_textures = bilinearInterpolatePayload(texs, level);
-        GColor** i_colors = bilinearInterpolatePayload(colors, level);
-
-        // construct the indices array, which is identical for all payloads 
-        int numOfTriangles = (level + 1) * (level + 1) * 2;
-        int* indices = new int[numOfTriangles * 3];
-        int idx = 0;
-        for (int t = 0; t < level + 1; t ++) {
-            for (int s = 0; s < level + 1; s ++) {
-                // top left triangle
-                indices[idx] = t * (level + 2) + s;
-                indices[idx+1] = indices[idx] + 1;
-                indices[idx+2] = (t + 1) * (level + 2) + s;
-                // bot right triangle
-                indices[idx+3] = indices[idx+2];
-                indices[idx+4] = indices[idx+1];
-                indices[idx+5] = (t + 1) * (level + 2) + (s + 1);
-
-                idx += 6;
-            }
+        ScratchScope scope(*this);
+        if (level < 0) return;
+        int n = level + 2; // vertices per side
+        if (n * n > kMaxQuadGridVerts) {
+            streamQuad(verts, colors, texs, level, paint);
+            return;
         }
 
-        // construct the vert[], colors[], texs[] arrays by flattening
-        GPoint* flat_i_vertices = new GPoint[(level + 2) * (level + 2)];
-        for (int i = 0; i < level + 2; i ++) {
-            for (int j = 0; j < level + 2; j ++) {
-                flat_i_vertices[i * (level + 2) + j] = i_vertices[i][j];
+        GPoint* gridVerts = scratch().alloc<GPoint>(n * n);
+        for (int t = 0; t < n; t ++) {
+            interpolateQuadRow(verts, t, level, &gridVerts[t * n]);
+        }
+        GColor* gridColors = nullptr;
+        if (colors != nullptr) {
+            gridColors = scratch().alloc<GColor>(n * n);
+            for (int t = 0; t < n; t ++) {
+                interpolateQuadRow(colors, t, level, &gridColors[t * n]);
             }
         }
-
-        GPoint* flat_i_textures;
-        if (i_textures != nullptr) {
-            flat_i_textures = new GPoint[(level + 2) * (level + 2)];
-            for (int i = 0; i < level + 2; i ++) {
-                for (int j = 0; j < level + 2; j ++) {
-                    flat_i_textures[i * (level + 2) + j] = i_textures[i][j];
-                }
+        GPoint* gridTexs = nullptr;
+        if (texs != nullptr) {
+            gridTexs = scratch().alloc<GPoint>(n * n);
+            for (int t = 0; t < n; t ++) {
+                interpolateQuadRow(texs, t, level, &gridTexs[t * n]);
             }
-        } else flat_i_textures = nullptr;
+        }
 
-        GColor* flat_i_colors;
-        if (i_colors != nullptr) {
-            flat_i_colors = new GColor[(level + 2) * (level + 2)];
-            for (int i = 0; i < level + 2; i ++) {
-                for (int j = 0; j < level + 2; j ++) {
-                    flat_i_colors[i * (level + 2) + j] = i_colors[i][j];
-                }
-            }
-        } else flat_i_colors = nullptr;
+        const vector<int>& indices = quadIndices(level);
+        drawMesh(gridVerts, gridColors, gridTexs, (int)indices.size() / 3, indices.data(), paint);
+    }
 
-        drawMesh(flat_i_vertices, flat_i_colors, flat_i_textures, numOfTriangles, indices, paint);
+    /// @brief Draw a quad mesh, subdivided just enough for its size and shape on the device.
+    /// @param maxError Pixel error budget; See GComputeQuadLevel.
+    void drawQuadAuto(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+                      float maxError, const GPaint& paint) override
+    {
+        GPoint deviceVerts[4];
+        matrixStack.top().mapPoints(deviceVerts, verts, 4);
+        drawQuad(verts, colors, texs, GComputeQuadLevel(deviceVerts, colors, texs, maxError), paint);
     }
 
     /// @brief Draw a rectangle given the shape and the paint.
     /// @param rect ~
     /// @param paint ~
     void drawRect(const GRect& rect, const GPaint& paint) {
+        ScratchScope scope(*this);
+        const GMatrix& ctm = matrixStack.top();
+        if (ctm[1] == 0 && ctm[3] == 0 && !paint.isAntiAlias()) {
+            // Translate/scale only; The rect stays axis-aligned in device space
+            fillAxisAlignedRect(rect, paint);
+            return;
+        }
+
         GPoint pts[4];
         pts[0] = { rect.fLeft,  rect.fTop };
         pts[1] = { rect.fRight, rect.fTop };
@@ -147,87 +256,108 @@ public:
     /// @brief Fill the entire canvas with the specified color, using the specified blendmode.
     /// @param paint Paint of the screen.
     void drawPaint(const GPaint& paint) override {
-        rowBlender rb = blenders.getBlender(paint.getBlendMode());
+        ScratchScope scope(*this);
         GShader* shaderptr = paint.getShader();
-        if (shaderptr == nullptr) {
-            // No shader is used
-            GPixel srcPixel = Blenders::prepSrcPixel(paint.getColor());
-            for (int r = 0; r < fDevice.height(); r ++) {
-                rb(0, fDevice.width(), &srcPixel, false, fDevice.getAddr(0, r));
-            }
-        } else {
-            shaderptr->setContext(matrixStack.top()); 
-            int rowBytes = fDevice.rowBytes() >> 2;
-            for (int r = 0; r < fDevice.height(); r ++) {
-                shaderptr->shadeRow(0, r, fDevice.width(), fDevice.pixels()+ r * rowBytes);
-            }
+        if (shaderptr) {
+            shaderptr->setContext(matrixStack.top());
         }
+        GBlitter blitter(paint);
+        if (blitter.isNoOp()) return;
+
+        const ClipState& clip = clipStack.top();
+        if (blitter.isSolid() && !clip.mask) {
+            fillSolid(clip.bounds, blitter.solidPixel());
+            return;
+        }
+        if (clip.mask || clip.bounds.width() != fDevice.width() || clip.bounds.height() != fDevice.height()) {
+            // Clipped: fill the clip bounds as spans, so the blit applies the mask
+            forEachTile(clip.bounds.fTop, clip.bounds.fBottom, [&](int tileTop, int tileBot) {
+                GSpanList spans(clip.bounds, scratch());
+                for (int y = tileTop; y < tileBot; y ++) {
+                    spans.add(y, clip.bounds.fLeft, clip.bounds.fRight - 1);
+                }
+                blitSpans(spans, blitter);
+            });
+            return;
+        }
+        forEachTile(0, fDevice.height(), [&](int top, int bot) {
+            for (int r = top; r < bot; r ++) {
+                blitter.blitSpan(0, r, fDevice.width(), fDevice.getAddr(0, r), nullptr);
+            }
+        });
     }
 
     /// @brief Draw a path using the specified paint.
     /// @param cpath ~
     /// @param paint ~
     void drawPath(const GPath& cpath, const GPaint& paint) {
+        ScratchScope scope(*this);
+        if (cpath.countPoints() == 0) return;
+
+        // Map the control-point bounds first, so off-screen paths are rejected before any copying
+        GRect local = cpath.bounds();
+        GPoint corners[4] = {
+            {local.fLeft, local.fTop}, {local.fRight, local.fTop},
+            {local.fRight, local.fBottom}, {local.fLeft, local.fBottom}
+        };
+        matrixStack.top().mapPoints(corners, 4);
+        BoundsTest test = testBounds(pointBounds(corners, 4));
+        if (test == kOutside) return;
+
         // Set the shader's context, if a shader is used.
         GShader* shaderptr = paint.getShader();
-        bool hasShader = (shaderptr != nullptr);
-        if (hasShader) {
+        if (shaderptr != nullptr) {
             shaderptr->setContext(matrixStack.top());
         }
-
-        // Transform the points from model space to device space using the ctm
-        GPath path = cpath;
-        path.transform(matrixStack.top());
-
-        vector<GEdge> edges = assembleEdges(path);
-
-        std::sort(edges.begin(), edges.end(), [](const GEdge& e1, const GEdge& e2){
-            if (e1.top == e2.top) {
-                float x1 = e1.m * (e1.top + 0.5) + e1.b;
-                float x2 = e2.m * (e2.top + 0.5) + e2.b;
-                return x1 < x2;
-            } else return e1.top < e2.top;
-        }); 
-        
-        for (int y = 0; y < fDevice.height();) {
-            if (edges.size() == 0) return;
-
-            // Blit the scan line
-            int i = 0;
-            int w = 0;
-            int left, right = 0;
-            while (i < static_cast<int>(edges.size()) && edges[i].top <= y) {
-                GEdge currEdge = edges[i];
-                int x = GRoundToInt(currEdge.m * ((float)y + 0.5) + currEdge.b); //!! Refactor into a GEdge method
-                if (w == 0) {
-                    left = x;
-                }
-                w += currEdge.orientation;
-                if (w == 0) {
-                    // the loop is closed
-                    right = x;
-                    fillRow(left, right, y, paint, hasShader);
-                }
-                if (edgeHasExpired(currEdge, y, edges)) {
-                    // printf("erasing edge at index %d; edges.size = %d \n", i, edges.size());
-                    edges.erase(edges.begin() + i);
-                } else {
-                    i++;
-                }
+        GBlitter blitter(paint);
+        if (blitter.isNoOp()) return;
+
+        // Redrawing a path under the same CTM reuses its edges from the cache
+        GEdgeCacheKey key(cpath.getGenerationID(), matrixStack.top());
+        bool needsClip = (test == kStraddles);
+        if (paint.isAntiAlias()) {
+            const vector<GSegment>* cachedSegments = segmentCache.find(key);
+            if (cachedSegments) {
+                fillSegmentsAA(*cachedSegments, blitter);
+                return;
             }
+            GArenaVector<GSegment> segments(scratch());
+            assembleEdges(cpath, matrixStack.top(), needsClip, segments);
+            sortSegments(segments);
+            segmentCache.insert(key, segments.begin(), segments.end());
+            fillSegmentsAA(segments, blitter);
+            return;
+        }
 
-            y++;
+        // The scan steps edges in place, so it works on a scratch copy
+        GArenaVector<GEdge> edges(scratch());
+        if (const vector<GEdge>* cached = edgeCache.find(key)) {
+            edges.assign(cached->begin(), cached->end());
+        } else {
+            assembleEdges(cpath, matrixStack.top(), needsClip, edges);
+            edgeCache.insert(key, edges.begin(), edges.end());
+        }
+        fillEdgesWinding(edges, blitter);
+    }
 
-            // Find active edges
-            // move index to include edges that will (in the next) be valid
-            while (i < static_cast<int>(edges.size()) && isActive(edges[i], y)) {
-                i++;
-            }
+    /// @brief Copy of the path, transformed from model space to device space by the CTM.
+    GPath devicePath(const GPath& path) const {
+        GPath transformed = path;
+        transformed.transform(matrixStack.top());
+        return transformed;
+    }
 
-            // Resort active edges
-            resortByCurrX(edges, y, i);
+    GPathCacheStats getPathCacheStats() const override {
+        GPathCacheStats stats;
+        stats.hits = edgeCache.hits() + segmentCache.hits();
+        stats.misses = edgeCache.misses() + segmentCache.misses();
+        stats.entries = edgeCache.count() + segmentCache.count();
+        return stats;
+    }
 
-        }
+    void setPathCacheLimit(int entries) override {
+        edgeCache.setCapacity(entries);
+        segmentCache.setCapacity(entries);
     }
 
     /// @brief Draw any convex polygon.
@@ -235,132 +365,469 @@ public:
     /// @param count Number of vertices.
     /// @param paint Paint to fill the polygon with.
     void drawConvexPolygon(const GPoint points[], int count, const GPaint& paint) {    
+        ScratchScope scope(*this);
         assert(count >= 0);
+        if (count < 3) return;
         // Set the shader's context, if a shader is used.
         GShader* shaderptr = paint.getShader();
-        bool hasShader = (shaderptr != nullptr);
-        if (hasShader) {
+        if (shaderptr != nullptr) {
             shaderptr->setContext(matrixStack.top());
         }
+        GBlitter blitter(paint);
+        if (blitter.isNoOp()) return;
 
         // Transform the points from model space to device space using the ctm
-        GPoint* transformedPoints = new GPoint[count];
-        matrixStack.top().mapPoints(transformedPoints, points, count);
-
-        // Prepare edges
-        vector<GEdge> edges = assembleEdges(transformedPoints, count);
-        delete[] transformedPoints; // Prevent memory leak
-        std::sort(edges.begin(), edges.end(), [](const GEdge& e1, const GEdge& e2){
-            if (e1.top == e2.top) {
-            return e1.bot < e2.bot;
-            } else return e1.top < e2.top;
-        }); // sort by Y
-        for (int y = 0; y < fDevice.height(); y++) {
-            if (edges.empty() || edges.size() == 1) break;
-            // Pick edges with the smallest y value (closer to the top of screen)
-            GEdge e1 = edges[0]; 
-            GEdge e2 = edges[1];
-            if (e2.top < e1.top) {
-                GEdge temp = e2;
-                e2 = e1;
-                e1 = temp;
-            }
-            if (y < e1.top || y > e2.bot) continue;
-            // Calculate left and right-most pixel covered by the shape
-            int idx1 = GRoundToInt(e1.m * ((float)y + 0.5) + e1.b);
-            int idx2 = GRoundToInt(e2.m * ((float)y + 0.5) + e2.b);
-
-            // Fill the entire row of pixel between left and right index
-            if (idx1 == idx2) { /* don't draw */ }
-            else if (idx1 < idx2) fillRow(idx1, idx2 - 1, y, paint, hasShader);
-            else fillRow(idx2, idx1 - 1, y, paint, hasShader);
-
-            // Retire expired edges by removing them; We maintain the invariance
-            // that edges with smallest y always has the smallest index in the array
-            if (edgeHasExpired(e2, y, edges)) edges.erase(edges.begin() + 1);
-            if (edgeHasExpired(e1, y, edges)) edges.erase(edges.begin());
+        GPoint* transformed = scratch().alloc<GPoint>(count);
+        matrixStack.top().mapPoints(transformed, points, count);
+        GRect bounds = pointBounds(transformed, count);
+        BoundsTest test = testBounds(bounds);
+        if (test == kOutside) return;
+        bool needsClip = (test == kStraddles);
+
+        if (paint.isAntiAlias()) {
+            GArenaVector<GSegment> segments(scratch());
+            assembleEdges(transformed, count, needsClip, segments);
+            sortSegments(segments);
+            fillSegmentsAA(segments, blitter);
+            return;
+        }
+
+        if (!fitsConvexWalk(bounds)) {
+            // Too far out for 16.16 stepping from the vertices; Clip, and fill as a path
+            GArenaVector<GEdge> edges(scratch());
+            assembleEdges(transformed, count, needsClip, edges);
+            fillEdgesWinding(edges, blitter);
+            return;
         }
+
+        int topIndex = 0, botIndex = 0;
+        for (int i = 1; i < count; i ++) {
+            if (transformed[i].fY < transformed[topIndex].fY) topIndex = i;
+            if (transformed[i].fY > transformed[botIndex].fY) botIndex = i;
+        }
+        const GIRect& clip = clipStack.top().bounds;
+        int top = std::max(GRoundToInt(bounds.fTop), clip.fTop);
+        int bot = std::min(GRoundToInt(bounds.fBottom), clip.fBottom);
+        forEachTile(top, bot, [&](int tileTop, int tileBot) {
+            scanConvex(transformed, count, topIndex, botIndex, tileTop, tileBot, [&](const GSpanList& spans) {
+                blitSpans(spans, blitter);
+            });
+        });
     };
 
     ///////////////////////////////////////////////////////////////////////////////////////////////
 
 private:
     GBitmap fDevice;
-    Blenders blenders;
     stack<GMatrix> matrixStack;
+    GThreadPool pool;
+
+    // Height of the fixed-size tiles (full-width bands of rows) that threads fill independently
+    static const int kTileHeight = 32;
+    // Max distance (in device pixels) between a curve and the lines it is flattened into
+    static constexpr float kFlatteningTolerance = 0.25f;
+    // Pixels an edge may reach past the left / right of the device without being clipped
+    static constexpr float kGuardBand = 32.0f;
+    // Largest drawQuad grid (in vertices) that is buffered whole; Larger ones are streamed
+    static const int kMaxQuadGridVerts = 64 * 64;
+    // Mesh triangles shorter than this are scanned on the calling thread
+    static const int kMinTiledTriangleRows = 4 * kTileHeight;
+
+    // Initial size of each scratch arena, per device column: room for a few rows of pixels and spans
+    static const int kArenaBytesPerColumn = 64;
+
+    /**
+     * @brief What the clip is at one save level: pixels outside bounds are never drawn,
+     * and those inside are further scaled by mask's coverage, if there is a mask.
+     */
+    struct ClipState {
+        GIRect bounds;
+        std::shared_ptr<const GClipMask> mask; // shared by the save levels above it
+    };
+    stack<ClipState> clipStack;
+
+    // Per-draw scratch memory, one arena per pool thread; See scratch()
+    vector<std::unique_ptr<GArena>> arenas;
+    int drawDepth; // nesting of ScratchScopes, as draws call other draws
+    std::unordered_map<int, vector<int>> quadIndexCache; // by level
+    // drawPath's edges, by path and CTM
+    GEdgeCache<GEdge> edgeCache;
+    GEdgeCache<GSegment> segmentCache;
+
+    /**
+     * @brief The calling thread's scratch arena; Valid until the outermost draw returns.
+     */
+    GArena& scratch() {
+        return *arenas[pool.threadIndex()];
+    }
+
+    /**
+     * @brief Opened at the top of every draw; When the outermost draw returns, all
+     * scratch memory is released at once.
+     */
+    struct ScratchScope {
+        Canvas& canvas;
+        ScratchScope(Canvas& canvas) : canvas(canvas) { canvas.drawDepth++; }
+        ~ScratchScope() {
+            if (--canvas.drawDepth == 0) {
+                for (auto& arena : canvas.arenas) arena->reset();
+            }
+        }
+    };
 
     ///////////////////////////////////////////////////////////////////////////////////////////////
 
-    void drawColorMesh(const GPoint vertices[], const GColor colors[], int count, const int indices[]) {
-        GPoint verts[3];
-        GColor cols[3];
-        for (int i = 0; i < 3 * count; i += 3) {
-            verts[0] = vertices[indices[i]];
-            verts[1] = vertices[indices[i+1]];
-            verts[2] = vertices[indices[i+2]];
+    /**
+     * @brief Run fillTile(top, bot) for every tile overlapping the rows [top, bot),
+     * with each call clamped to the rows of its tile. Tiles run in parallel when
+     * the canvas has more than one thread; Otherwise this is one call for all rows.
+     */
+    template <typename F> void forEachTile(int top, int bot, F fillTile) {
+        if (top >= bot) return;
+        int first = top / kTileHeight;
+        int last = (bot - 1) / kTileHeight;
+        if (pool.threadCount() == 1 || first == last) {
+            fillTile(top, bot);
+            return;
+        }
+        pool.parallelFor(last - first + 1, [&](int i) {
+            int tileTop = (first + i) * kTileHeight;
+            fillTile(std::max(tileTop, top), std::min(tileTop + kTileHeight, bot));
+        });
+    }
 
-            cols[0] = colors[indices[i]];
-            cols[1] = colors[indices[i+1]];
-            cols[2] = colors[indices[i+2]];
+    /**
+     * @brief One side of a convex polygon: the vertices from its top vertex to its
+     * bottom vertex, walked in one direction, with the edge under the current row.
+     */
+    struct ConvexChain {
+        const GPoint* pts;
+        int count;
+        int index; // vertex at the bottom of the current edge
+        int stop;  // bottom vertex of the polygon
+        int dir;   // +1 or -1
+        GEdge edge;
+        bool hasEdge;
+
+        ConvexChain(const GPoint pts[], int count, int top, int bot, int dir)
+            : pts(pts), count(count), index(top), stop(bot), dir(dir), edge(), hasEdge(false) {}
+
+        /**
+         * @brief Make edge the chain's edge under row y, with x stepped to that row.
+         * @return False once the chain has no edge reaching row y.
+         */
+        bool advanceTo(int y) {
+            while (!hasEdge || y >= edge.bot) {
+                if (index == stop) return false;
+                GPoint p0 = pts[index];
+                index = (index + dir + count) % count;
+                GPoint p1 = pts[index];
+                if (p1.fY < p0.fY) std::swap(p0, p1); // Only if the polygon isn't really convex
+                hasEdge = makeGEdge(p0, p1, 1, &edge) && edge.bot > y;
+                if (hasEdge && edge.top < y) {
+                    // Same value stepping row by row would reach
+                    edge.x += (y - edge.top) * edge.dx;
+                    edge.top = y;
+                }
+            }
+            return true;
+        }
+    };
 
-            std::unique_ptr<GShader> cs = GCreateTriColorShader(cols, verts);
-            drawConvexPolygon(verts, 3, GPaint(cs.get()));
+    /**
+     * @brief Whether every coordinate is small enough that walking a chain in 16.16,
+     * including jumping straight to a tile's first row, cannot overflow.
+     */
+    static bool fitsConvexWalk(const GRect& bounds) {
+        const float kMax = 8192.0f;
+        return bounds.fLeft >= -kMax && bounds.fRight <= kMax && bounds.fTop >= -kMax && bounds.fBottom <= kMax;
+    }
+
+    /**
+     * @brief Fill the rows [yTop, yBot) of a convex polygon by walking its left and
+     * right vertex chains down from the top vertex; No edge list, sorting or clipping.
+     * X is clamped to the device when the spans are emitted.
+     * @param blit Called with each batch of spans.
+     */
+    template <typename Blit> void scanConvex(const GPoint pts[], int count, int topIndex, int botIndex,
+                                             int yTop, int yBot, const Blit& blit) {
+        ConvexChain a(pts, count, topIndex, botIndex, 1);
+        ConvexChain b(pts, count, topIndex, botIndex, -1);
+        GSpanList spans(clipStack.top().bounds, scratch());
+        for (int y = yTop; y < yBot; y ++) {
+            if (!a.advanceTo(y) || !b.advanceTo(y)) break;
+            if (y >= a.edge.top && y >= b.edge.top) {
+                int x0 = a.edge.currX();
+                int x1 = b.edge.currX();
+                if (x0 > x1) std::swap(x0, x1);
+                spans.add(y, x0, x1 - 1);
+                if (spans.isFull()) {
+                    blit(spans);
+                    spans.reset();
+                }
+            }
+            if (y >= a.edge.top) a.edge.step();
+            if (y >= b.edge.top) b.edge.step();
         }
+        blit(spans);
     }
 
-    void drawTexMesh(const GPoint vertices[], const GPoint textures[],
-     int count, const int indices[], const GPaint& textureShader) 
-    {
-        GPoint verts[3];
-        GPoint texs[3];
-        for (int i = 0; i < 3 * count; i += 3) {
-            verts[0] = vertices[indices[i]];
-            verts[1] = vertices[indices[i+1]];
-            verts[2] = vertices[indices[i+2]];
+    /**
+     * @brief What every triangle of one mesh draw shares.
+     */
+    struct MeshBlit {
+        bool hasColor;
+        GShader* texShader; // null if not textured
+        GBlitter blitter;
+        GPixel* srcRow;     // scratch rows for the calling thread, as wide as the device
+        GPixel* texRow;
+    };
 
-            texs[0] = textures[indices[i]];
-            texs[1] = textures[indices[i+1]];
-            texs[2] = textures[indices[i+2]];
+    /**
+     * @brief Set up a mesh draw, with scratch rows from the calling thread's arena.
+     */
+    MeshBlit beginMesh(bool hasColor, GShader* texShader, const GPaint& paint) {
+        // The source is the mesh's colors and texture, not the paint's color
+        MeshBlit blit = {hasColor, texShader, GBlitter(paint.getBlendMode()), nullptr, nullptr};
+        return withScratchRows(blit);
+    }
+
+    /**
+     * @brief A copy of blit whose scratch rows come from the calling thread's arena.
+     */
+    MeshBlit withScratchRows(MeshBlit blit) {
+        blit.srcRow = scratch().alloc<GPixel>(fDevice.width());
+        blit.texRow = blit.hasColor && blit.texShader != nullptr ? scratch().alloc<GPixel>(fDevice.width()) : nullptr;
+        return blit;
+    }
 
-            std::unique_ptr<GShader> ts 
-                        = GCreateTriTexShader(texs, verts, textureShader.getShader());
-            drawConvexPolygon(verts, 3, GPaint(ts.get()));
+    /**
+     * @brief Rasterize and shade one mesh triangle.
+     * @param pts Device space vertices.
+     * @param colors,texs The vertices' colors / texture UVs; Ignored if the mesh has none.
+     */
+    void drawMeshTriangle(const MeshBlit& blit, const GPoint pts[3], const GColor colors[3], const GPoint texs[3]) {
+        GRect bounds = pointBounds(pts, 3);
+        BoundsTest test = testBounds(bounds);
+        if (test == kOutside) return;
+
+        MeshPlanes planes;
+        if (!planes.setTriangle(pts)) return; // No area, so no pixel centers
+        if (blit.hasColor) {
+            planes.setColors(colors[0], colors[1], colors[2]);
+        }
+        if (blit.texShader != nullptr) {
+            // Map texture space onto the device triangle; The shader inverts it itself
+            GMatrix texToUnit;
+            GMatrix unitToTex(texs[1].fX - texs[0].fX, texs[2].fX - texs[0].fX, texs[0].fX,
+                              texs[1].fY - texs[0].fY, texs[2].fY - texs[0].fY, texs[0].fY);
+            if (!unitToTex.invert(&texToUnit)) return;
+            GMatrix unitToDevice(pts[1].fX - pts[0].fX, pts[2].fX - pts[0].fX, pts[0].fX,
+                                 pts[1].fY - pts[0].fY, pts[2].fY - pts[0].fY, pts[0].fY);
+            if (!blit.texShader->setContext(GMatrix::Concat(unitToDevice, texToUnit))) return;
+        }
+
+        if (!fitsConvexWalk(bounds)) {
+            // Too far out for the vertex walk; Clip, and fill as a path (rare, so
+            // the scratch rows are just taken per batch)
+            GArenaVector<GEdge> edges(scratch());
+            assembleEdges(pts, 3, test == kStraddles, edges);
+            fillEdgesWinding(edges, [&](const GSpanList& spans) {
+                blitMeshSpans(spans, planes, withScratchRows(blit));
+            });
+            return;
         }
+
+        int topIndex = 0, botIndex = 0;
+        for (int v = 1; v < 3; v ++) {
+            if (pts[v].fY < pts[topIndex].fY) topIndex = v;
+            if (pts[v].fY > pts[botIndex].fY) botIndex = v;
+        }
+        const GIRect& clip = clipStack.top().bounds;
+        int top = std::max(GRoundToInt(bounds.fTop), clip.fTop);
+        int bot = std::min(GRoundToInt(bounds.fBottom), clip.fBottom);
+        if (bot - top < kMinTiledTriangleRows) {
+            // Waking the pool costs more than a small triangle takes to scan
+            scanConvex(pts, 3, topIndex, botIndex, top, bot, [&](const GSpanList& spans) {
+                blitMeshSpans(spans, planes, blit);
+            });
+            return;
+        }
+        bool tiled = pool.threadCount() > 1;
+        forEachTile(top, bot, [&](int tileTop, int tileBot) {
+            // Tiles run in parallel, so each needs its own scratch rows
+            MeshBlit tileBlit = tiled ? withScratchRows(blit) : blit;
+            scanConvex(pts, 3, topIndex, botIndex, tileTop, tileBot, [&](const GSpanList& spans) {
+                blitMeshSpans(spans, planes, tileBlit);
+            });
+        });
     }
 
-    void drawColorTexMesh(const GPoint vertices[], const GColor colors[], const GPoint textures[],
-                          int count, const int indices[], const GPaint& textureShader)
-    {
-        GPoint verts[3];
-        GPoint texs[3];
-        GColor cols[3];
-        for (int i = 0; i < 3 * count; i += 3) {
-            verts[0] = vertices[indices[i]];
-            verts[1] = vertices[indices[i+1]];
-            verts[2] = vertices[indices[i+2]];
+    /**
+     * @brief Color plane equations of one mesh triangle, in device space:
+     * C(x, y) = c0 + (x - origin.x) * dcdx + (y - origin.y) * dcdy
+     */
+    struct MeshPlanes {
+        GPoint origin;
+        GPoint e1, e2; // edges from vertex 0
+        float invDet;
+        GColor c0, dcdx, dcdy;
+
+        /**
+         * @return False if the triangle has no area.
+         */
+        bool setTriangle(const GPoint pts[3]) {
+            origin = pts[0];
+            e1 = pts[1] - pts[0];
+            e2 = pts[2] - pts[0];
+            float det = e1.fX * e2.fY - e2.fX * e1.fY;
+            if (det == 0) return false;
+            invDet = 1 / det;
+            return true;
+        }
+
+        void setColors(const GColor& col0, const GColor& col1, const GColor& col2) {
+            GColor d1 = col1 - col0;
+            GColor d2 = col2 - col0;
+            c0 = col0;
+            dcdx = (e2.fY * invDet) * d1 - (e1.fY * invDet) * d2;
+            dcdy = (e1.fX * invDet) * d2 - (e2.fX * invDet) * d1;
+        }
+
+        GColor colorAt(float x, float y) const {
+            return c0 + (x - origin.fX) * dcdx + (y - origin.fY) * dcdy;
+        }
+    };
+
+    /**
+     * @brief A mesh triangle set up for scanning: its device vertices, color planes, and
+     * the rows it covers within the clip.
+     */
+    struct MeshTriangle {
+        GPoint pts[3];
+        MeshPlanes planes;
+        int topIndex, botIndex;
+        int top, bot;
+    };
 
-            texs[0] = textures[indices[i]];
-            texs[1] = textures[indices[i+1]];
-            texs[2] = textures[indices[i+2]];
+    /**
+     * @brief One copy of blit per pool thread: The calling thread's shares blit's scratch
+     * rows, and the others have none until drawMeshBinned gives them their own.
+     */
+    GArenaVector<MeshBlit> perThreadMeshBlits(const MeshBlit& blit) {
+        GArenaVector<MeshBlit> threadBlits(pool.threadCount(), blit, scratch());
+        for (int i = 1; i < pool.threadCount(); i ++) {
+            threadBlits[i].srcRow = nullptr;
+        }
+        return threadBlits;
+    }
+
+    /**
+     * @brief Draw the triangles of an untextured mesh on a tiled canvas with one job per
+     * tile: Each triangle is set up once and binned into the tiles it touches, and each
+     * tile scans its bin in mesh order, so overlapping triangles still blend in order.
+     * The setup is freed on return, so streamed bands can call this again and again.
+     * @param threadBlits From perThreadMeshBlits; Workers fill in their scratch rows.
+     * @return False, having drawn nothing, if a triangle is too far out for the vertex walk.
+     */
+    bool drawMeshBinned(GArenaVector<MeshBlit>& threadBlits, const GPoint verts[], const GColor colors[],
+                        int count, const int indices[]) {
+        GArena& arena = scratch();
+        size_t mark = arena.mark();
+        const GIRect& clip = clipStack.top().bounds;
+        int tiles = (fDevice.height() + kTileHeight - 1) / kTileHeight;
+        MeshTriangle* tris = arena.alloc<MeshTriangle>(count);
+        GArenaVector<GArenaVector<int>> bins(tiles, GArenaVector<int>(arena), arena);
+        int kept = 0;
+        int firstTile = tiles, lastTile = -1;
+        for (int i = 0; i < 3 * count; i += 3) {
+            int i0 = indices[i], i1 = indices[i + 1], i2 = indices[i + 2];
+            MeshTriangle& tri = tris[kept];
+            tri.pts[0] = verts[i0]; tri.pts[1] = verts[i1]; tri.pts[2] = verts[i2];
+            GRect bounds = pointBounds(tri.pts, 3);
+            if (testBounds(bounds) == kOutside) continue;
+            if (!fitsConvexWalk(bounds)) {
+                arena.rewind(mark);
+                return false;
+            }
+            if (!tri.planes.setTriangle(tri.pts)) continue;
+            tri.planes.setColors(colors[i0], colors[i1], colors[i2]);
+            tri.topIndex = tri.botIndex = 0;
+            for (int v = 1; v < 3; v ++) {
+                if (tri.pts[v].fY < tri.pts[tri.topIndex].fY) tri.topIndex = v;
+                if (tri.pts[v].fY > tri.pts[tri.botIndex].fY) tri.botIndex = v;
+            }
+            tri.top = std::max(GRoundToInt(bounds.fTop), clip.fTop);
+            tri.bot = std::min(GRoundToInt(bounds.fBottom), clip.fBottom);
+            if (tri.top >= tri.bot) continue;
+            for (int t = tri.top / kTileHeight; t * kTileHeight < tri.bot; t ++) {
+                bins[t].push_back(kept);
+            }
+            firstTile = std::min(firstTile, tri.top / kTileHeight);
+            lastTile = std::max(lastTile, (tri.bot - 1) / kTileHeight);
+            kept ++;
+        }
 
-            cols[0] = colors[indices[i]];
-            cols[1] = colors[indices[i+1]];
-            cols[2] = colors[indices[i+2]];
+        // Only the tiles the mesh touches; A mesh within one tile runs on the calling thread
+        pool.parallelFor(lastTile - firstTile + 1, [&](int i) {
+            int t = firstTile + i;
+            if (bins[t].empty()) return;
+            int slot = pool.threadIndex();
+            if (threadBlits[slot].srcRow == nullptr) {
+                // Taken once per thread and draw, not once per tile
+                threadBlits[slot] = withScratchRows(threadBlits[slot]);
+            }
+            int tileTop = t * kTileHeight;
+            int tileBot = std::min(tileTop + kTileHeight, fDevice.height());
+            for (int i : bins[t]) {
+                const MeshTriangle& tri = tris[i];
+                scanConvex(tri.pts, 3, tri.topIndex, tri.botIndex, std::max(tri.top, tileTop),
+                           std::min(tri.bot, tileBot), [&](const GSpanList& spans) {
+                    blitMeshSpans(spans, tri.planes, threadBlits[slot]);
+                });
+            }
+        });
+        arena.rewind(mark);
+        return true;
+    }
 
-            std::unique_ptr<GShader> ts 
-                        = GCreateTriTexShader(texs, verts, textureShader.getShader());
-            std::unique_ptr<GShader> cs = GCreateTriColorShader(cols, verts);
-            std::unique_ptr<GShader> tcs 
-                        = GCreateTriColorTexShader((TriTexShader*)(ts.get()),
-                            (TriColorShader*)(cs.get()));
-            drawConvexPolygon(verts, 3, GPaint(tcs.get()));
+    /**
+     * @brief The blit stage for mesh triangles: shade each span from the triangle's
+     * planes and/or the texture shader (already set up for the triangle), then blend.
+     */
+    void blitMeshSpans(const GSpanList& spans, const MeshPlanes& planes, const MeshBlit& blit) {
+        GShader* texShader = blit.texShader;
+        GPixel* src = blit.srcRow;
+        GPixel* tex = blit.texRow;
+        const GClipMask* mask = clipStack.top().mask.get();
+        for (const GSpan& span : spans.getSpans()) {
+            if (blit.hasColor) {
+                GColor c = planes.colorAt(span.x + 0.5f, span.y + 0.5f);
+                for (int i = 0; i < span.count; i ++) {
+                    src[i] = Blenders::prepSrcPixel(c);
+                    c += planes.dcdx;
+                }
+                if (texShader != nullptr) {
+                    // Modulate the color by the texture
+                    texShader->shadeRow(span.x, span.y, span.count, tex);
+                    for (int i = 0; i < span.count; i ++) {
+                        src[i] = GPixel_PackARGB(
+                            Blenders::div255(GPixel_GetA(tex[i]) * GPixel_GetA(src[i])),
+                            Blenders::div255(GPixel_GetR(tex[i]) * GPixel_GetR(src[i])),
+                            Blenders::div255(GPixel_GetG(tex[i]) * GPixel_GetG(src[i])),
+                            Blenders::div255(GPixel_GetB(tex[i]) * GPixel_GetB(src[i])));
+                    }
+                }
+            } else {
+                texShader->shadeRow(span.x, span.y, span.count, src);
+            }
+            // Mesh spans are fully covered, so the mask row, if any, is their coverage
+            blit.blitter.blendRow(fDevice.getAddr(span.x, span.y), src,
+                                  mask ? mask->getAddr(span.x, span.y) : nullptr, span.count);
         }
     }
 
-    /// @brief Bilinear interpolation of payload for each sub-quad after the division
-    /// @param payload the payload to interpolate
-    /// @param level LoD of subdivisions
-    /// @return 2-D array of interpolated payload after the division
+    /// @brief Bilinear interpolation of one row of the payload for the sub-quads.
     //  * We divide the original quad into (level + 1) * (level + 1) sub-quads.
     //  *      0---1 (s)
     //  *      |   | 
@@ -369,107 +836,342 @@ private:
     //  *      |   |
     //  *      3---2
     //  *     (t)
-    GPoint** bilinearInterpolatePayload(const GPoint payload[4], int level) {
-        if (payload == nullptr) return nullptr;
+    /// @param row Receives the level + 2 interpolated values of row t.
+    template <typename T> static void interpolateQuadRow(const T payload[4], int t, int level, T row[]) {
+        T p0 = payload[0] + (payload[3] - payload[0]) * ((float)t / (level + 1));
+        T p1 = payload[1] + (payload[2] - payload[1]) * ((float)t / (level + 1));
+        for (int s = 0; s < level + 2; s ++) {
+            row[s] = p0 + (p1 - p0) * ((float)s / (level + 1));
+        }
+    }
 
-        GPoint** interpolations = new GPoint*[level + 2];
-        for (int t = 0; t < level + 2; t ++) {
-            interpolations[t] = new GPoint[level + 2];
-            GPoint p0 = payload[0] + (payload[3] - payload[0]) * ((float)t / (level + 1));
-            GPoint p1 = payload[1] + (payload[2] - payload[1]) * ((float)t / (level + 1));
-            for (int s = 0; s < level + 2; s ++) {
-                interpolations[t][s] = p0 + (p1 - p0) * ((float)s / (level + 1));
+    /**
+     * @brief The triangle indices of a quad grid of the given level, built once per level.
+     * Each sub-quad is its top left triangle followed by its bottom right one.
+     */
+    const vector<int>& quadIndices(int level) {
+        vector<int>& indices = quadIndexCache[level];
+        if (!indices.empty()) return indices;
+
+        int n = level + 2;
+        indices.reserve((level + 1) * (level + 1) * 6);
+        for (int t = 0; t < level + 1; t ++) {
+            for (int s = 0; s < level + 1; s ++) {
+                // top left triangle
+                indices.push_back(t * n + s);
+                indices.push_back(t * n + s + 1);
+                indices.push_back((t + 1) * n + s);
+                // bot right triangle
+                indices.push_back((t + 1) * n + s);
+                indices.push_back(t * n + s + 1);
+                indices.push_back((t + 1) * n + s + 1);
             }
         }
-        return interpolations;
+        return indices;
     }
 
-    GColor** bilinearInterpolatePayload(const GColor payload[4], int level) {
-        if (payload == nullptr) return nullptr;
-
-        GColor** interpolations = new GColor*[level + 2];
-        for (int t = 0; t < level + 2; t ++) {
-            interpolations[t] = new GColor[level + 2];
-            GColor p0 = payload[0] + (payload[3] - payload[0]) * ((float)t / (level + 1));
-            GColor p1 = payload[1] + (payload[2] - payload[1]) * ((float)t / (level + 1));
-            for (int s = 0; s < level + 2; s ++) {
-                interpolations[t][s] = p0 + (p1 - p0) * ((float)s / (level + 1));
+    /**
+     * @brief Draw a quad grid too large to buffer, keeping only the rows above and
+     * below the current band of sub-quads. Emits the same triangles, in the same
+     * order, as drawing the full grid with quadIndices.
+     */
+    void streamQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+                    int level, const GPaint& paint) {
+        GShader* texShader = texs != nullptr ? paint.getShader() : nullptr;
+        if (colors == nullptr && texShader == nullptr) return;
+
+        int n = level + 2;
+        // Two rows of each payload: the rows above and below the band
+        GPoint* verts0 = scratch().alloc<GPoint>(2 * n);
+        GPoint* verts1 = verts0 + n;
+        GColor* colors0 = scratch().alloc<GColor>(2 * n);
+        GColor* colors1 = colors0 + n;
+        GPoint* texs0 = scratch().alloc<GPoint>(2 * n);
+        GPoint* texs1 = texs0 + n;
+
+        const GMatrix& ctm = matrixStack.top();
+        auto loadRow = [&](int t, GPoint* v, GColor* c, GPoint* tx) {
+            interpolateQuadRow(verts, t, level, v);
+            ctm.mapPoints(v, v, n);
+            if (colors != nullptr) interpolateQuadRow(colors, t, level, c);
+            if (texShader != nullptr) interpolateQuadRow(texs, t, level, tx);
+        };
+
+        MeshBlit blit = beginMesh(colors != nullptr, texShader, paint);
+        if (blit.blitter.isNoOp()) return;
+        // Untextured bands on a tiled canvas are binned a band at a time, as a mesh of two rows
+        bool binBands = texShader == nullptr && pool.threadCount() > 1;
+        GArenaVector<MeshBlit> threadBlits(scratch());
+        GPoint* bandVerts = nullptr;
+        GColor* bandColors = nullptr;
+        int* bandIndices = nullptr;
+        if (binBands) {
+            threadBlits = perThreadMeshBlits(blit);
+            bandVerts = scratch().alloc<GPoint>(2 * n);
+            bandColors = scratch().alloc<GColor>(2 * n);
+            bandIndices = scratch().alloc<int>((level + 1) * 6);
+            for (int s = 0; s < level + 1; s ++) {
+                const int quad[6] = {s, s + 1, n + s, n + s, s + 1, n + s + 1};
+                std::copy(quad, quad + 6, &bandIndices[s * 6]);
             }
         }
-        return interpolations;
+        loadRow(0, verts0, colors0, texs0);
+        for (int t = 0; t < level + 1; t ++) {
+            loadRow(t + 1, verts1, colors1, texs1);
+            bool binned = false;
+            if (binBands) {
+                std::copy(verts0, verts0 + n, bandVerts);
+                std::copy(verts1, verts1 + n, bandVerts + n);
+                std::copy(colors0, colors0 + n, bandColors);
+                std::copy(colors1, colors1 + n, bandColors + n);
+                binned = drawMeshBinned(threadBlits, bandVerts, bandColors, 2 * (level + 1), bandIndices);
+            }
+            if (!binned) {
+                for (int s = 0; s < level + 1; s ++) {
+                    const GPoint topLeft[3] = {verts0[s], verts0[s + 1], verts1[s]};
+                    const GPoint botRight[3] = {verts1[s], verts0[s + 1], verts1[s + 1]};
+                    GColor c[3];
+                    GPoint tx[3];
+                    if (colors != nullptr) {
+                        c[0] = colors0[s]; c[1] = colors0[s + 1]; c[2] = colors1[s];
+                    }
+                    if (texShader != nullptr) {
+                        tx[0] = texs0[s]; tx[1] = texs0[s + 1]; tx[2] = texs1[s];
+                    }
+                    drawMeshTriangle(blit, topLeft, c, tx);
+                    if (colors != nullptr) {
+                        c[0] = colors1[s]; c[1] = colors0[s + 1]; c[2] = colors1[s + 1];
+                    }
+                    if (texShader != nullptr) {
+                        tx[0] = texs1[s]; tx[1] = texs0[s + 1]; tx[2] = texs1[s + 1];
+                    }
+                    drawMeshTriangle(blit, botRight, c, tx);
+                }
+            }
+            std::swap(verts0, verts1);
+            std::swap(colors0, colors1);
+            std::swap(texs0, texs1);
+        }
     }
 
     /**
-     * @brief Determine if the scan line is the last scan line that will 
-     * touch the given edge.
+     * @brief Fill a rect whose CTM only translates and scales, without building edges.
+     * The device rect is rounded the same way prepGEdge rounds edges, so this
+     * covers exactly the pixels drawConvexPolygon would.
      */
-    bool edgeHasExpired(GEdge edge, int scan, vector<GEdge>edges) {
-        if (!(scan <= edge.bot && scan >= edge.top)){
-            
+    void fillAxisAlignedRect(const GRect& rect, const GPaint& paint) {
+        const GMatrix& ctm = matrixStack.top();
+        GIRect r = intersect(deviceRect(rect), clipStack.top().bounds);
+        if (r.isEmpty()) return;
+        int left = r.fLeft, right = r.fRight, top = r.fTop, bot = r.fBottom;
+
+        GShader* shaderptr = paint.getShader();
+        if (shaderptr != nullptr) {
+            shaderptr->setContext(ctm);
+        }
+        GBlitter blitter(paint);
+        if (blitter.isNoOp()) return;
+        if (blitter.isSolid() && !clipStack.top().mask) {
+            fillSolid(r, blitter.solidPixel());
+            return;
         }
-        return scan == edge.bot - 1;
+        forEachTile(top, bot, [&](int tileTop, int tileBot) {
+            GSpanList spans(clipStack.top().bounds, scratch());
+            for (int y = tileTop; y < tileBot; y ++) {
+                spans.add(y, left, right - 1);
+                flushIfFull(spans, blitter);
+            }
+            blitSpans(spans, blitter);
+        });
     }
 
     /**
-     * @brief Blend pixels between left and right index on row y with the paint.
-     * 
-     * @param left [Inclusive] Left-most index of the pixel included by the shape.
-     * @param right [Inclusive] Right-most index of the pixel included by the shape.
-     * @param row y value of the row.
-     * @param paint Source paint.
-     * @param hasShader whether paint is using a shader or not
-     */
-    void fillRow(int left, int right, int row, const GPaint& paint, bool hasShader) {
-        // assert(count >= 0);
-        //!! opt: default parameter, pass in shaderptr
-        if (left < 0) left = 0;
-        if (right < 0) right = 0;
-        if (left >= fDevice.width()) left = fDevice.width() - 1;
-        if (right >= fDevice.width()) right = fDevice.width() - 1;
-        rowBlender rb = blenders.getBlender(paint.getBlendMode());
-        int count = right - left + 1;
-        
-        if (!hasShader) { 
-            // Shader is not used 
-            GPixel srcPixel = Blenders::prepSrcPixel(paint.getColor());
-            rb(left, count, &srcPixel, false, fDevice.getAddr(left, row));
-        } else {
-            // Shader is used
-            GShader* shaderptr = paint.getShader();
-            if (shaderptr->isOpaque()) {
-                // Opague color will overwrite the original color completely
-                shaderptr->shadeRow(left, row, count, fDevice.getAddr(left, row));
-            } else {
-                assert(count >= 0);
-                GPixel* srcPixels = new GPixel[count];
-                shaderptr->shadeRow(left, row, count, srcPixels);
-                rb(left, count, srcPixels, true, fDevice.getAddr(left, row));
-                delete[] srcPixels; // prevent memory leaks
+     * @brief Set every pixel of r, which must be inside the device, to pixel.
+     * Rows that follow each other in memory are filled as one run, and fills too
+     * large to stay in the cache are streamed around it.
+     */
+    void fillSolid(const GIRect& r, GPixel pixel) {
+        bool streaming = (size_t)r.width() * r.height() * sizeof(GPixel) >= kGStreamingFillBytes;
+        bool contiguous = r.width() == fDevice.width() && fDevice.rowBytes() == r.width() * sizeof(GPixel);
+        forEachTile(r.fTop, r.fBottom, [&](int top, int bot) {
+            if (contiguous) {
+                GFillRow(fDevice.getAddr(0, top), pixel, (size_t)(bot - top) * r.width(), streaming);
+                return;
             }
+            for (int y = top; y < bot; y ++) {
+                GFillRow(fDevice.getAddr(r.fLeft, y), pixel, r.width(), streaming);
+            }
+        });
+    }
+
+    /**
+     * @brief The blit stage: shade and blend every span in the list.
+     * 
+     * The blitter was picked once for the whole draw.
+     * 
+     * @param spans Spans from one rasterizer pass.
+     * @param blitter The draw's blitter.
+     */
+    void blitSpans(const GSpanList& spans, const GBlitter& blitter) {
+        if (spans.isEmpty()) return;
+        const GClipMask* mask = clipStack.top().mask.get();
+        uint8_t* maskedCoverage = mask ? scratch().alloc<uint8_t>(spans.maxCount()) : nullptr;
+        for (const GSpan& span : spans.getSpans()) {
+            blitter.blitSpan(span.x, span.y, span.count, fDevice.getAddr(span.x, span.y),
+                             spanCoverage(spans, span, mask, maskedCoverage));
+        }
+    }
+
+    /**
+     * @brief Coverage of a span's pixels, with the clip mask applied; Null if fully covered.
+     * @param mask The clip mask, or null.
+     * @param scratch Room for the span's coverage, when both it and the mask have some.
+     */
+    static const uint8_t* spanCoverage(const GSpanList& spans, const GSpan& span, const GClipMask* mask,
+                                       uint8_t scratch[]) {
+        if (mask == nullptr) {
+            return span.coverage < 0 ? nullptr : spans.getCoverage(span);
+        }
+        const uint8_t* maskRow = mask->getAddr(span.x, span.y);
+        if (span.coverage < 0) {
+            return maskRow;
+        }
+        const uint8_t* coverage = spans.getCoverage(span);
+        for (int i = 0; i < span.count; i ++) {
+            scratch[i] = Blenders::div255(coverage[i] * maskRow[i]);
+        }
+        return scratch;
+    }
+
+    /**
+     * @brief Blit and empty the list once it is full, so long scans run in bounded batches.
+     */
+    void flushIfFull(GSpanList& spans, const GBlitter& blitter) {
+        if (spans.isFull()) {
+            blitSpans(spans, blitter);
+            spans.reset();
+        }
+    }
+
+    /**
+     * @brief The pixels a rect covers under a CTM that only translates and scales,
+     * pinned to the device; Rounded the same way prepGEdge rounds edges.
+     */
+    GIRect deviceRect(const GRect& rect) const {
+        const GMatrix& ctm = matrixStack.top();
+        float x0 = ctm[0] * rect.fLeft + ctm[2];
+        float x1 = ctm[0] * rect.fRight + ctm[2];
+        float y0 = ctm[4] * rect.fTop + ctm[5];
+        float y1 = ctm[4] * rect.fBottom + ctm[5];
+
+        // Pin to the device first, so huge rects can't overflow the rounding
+        float width = (float)fDevice.width();
+        float height = (float)fDevice.height();
+        return GIRect::LTRB(GRoundToInt(std::max(std::min(x0, x1), 0.0f)),
+                            GRoundToInt(std::max(std::min(y0, y1), 0.0f)),
+                            GRoundToInt(std::min(std::max(x0, x1), width)),
+                            GRoundToInt(std::min(std::max(y0, y1), height)));
+    }
+
+    /**
+     * @brief Smallest pixel rect holding the device-space bounds, pinned to the device.
+     */
+    GIRect roundOut(const GRect& bounds) const {
+        GRect pinned = GRect::LTRB(std::max(bounds.fLeft, 0.0f), std::max(bounds.fTop, 0.0f),
+                                   std::min(bounds.fRight, (float)fDevice.width()),
+                                   std::min(bounds.fBottom, (float)fDevice.height()));
+        if (!(pinned.fLeft < pinned.fRight && pinned.fTop < pinned.fBottom)) return GIRect::LTRB(0, 0, 0, 0);
+        return pinned.roundOut();
+    }
+
+    static GIRect intersect(const GIRect& a, const GIRect& b) {
+        GIRect r = GIRect::LTRB(std::max(a.fLeft, b.fLeft), std::max(a.fTop, b.fTop),
+                                std::min(a.fRight, b.fRight), std::min(a.fBottom, b.fBottom));
+        return r.isEmpty() ? GIRect::LTRB(0, 0, 0, 0) : r;
+    }
+
+    enum BoundsTest { kOutside, kInside, kStraddles };
+
+    /**
+     * @brief Bounds of the points.
+     */
+    static GRect pointBounds(const GPoint points[], int count) {
+        GRect r = GRect::LTRB(points[0].fX, points[0].fY, points[0].fX, points[0].fY);
+        for (int i = 1; i < count; i ++) {
+            r.fLeft = std::min(r.fLeft, points[i].fX);
+            r.fRight = std::max(r.fRight, points[i].fX);
+            r.fTop = std::min(r.fTop, points[i].fY);
+            r.fBottom = std::max(r.fBottom, points[i].fY);
         }
+        return r;
+    }
+
+    /**
+     * @brief Classify device-space bounds against the clip and the device.
+     * kInside: nothing needs clipping to the device. kOutside: a fill inside them
+     * covers no pixel inside the clip, so it can be dropped before building edges.
+     */
+    BoundsTest testBounds(const GRect& bounds) const {
+        float width = (float)fDevice.width();
+        float height = (float)fDevice.height();
+        const GIRect& clip = clipStack.top().bounds;
+        if (bounds.fRight <= clip.fLeft || bounds.fLeft >= clip.fRight ||
+            bounds.fBottom <= clip.fTop || bounds.fTop >= clip.fBottom) {
+            return kOutside;
+        }
+        if (bounds.fLeft >= 0 && bounds.fRight <= width && bounds.fTop >= 0 && bounds.fBottom <= height) {
+            return kInside;
+        }
+        return kStraddles;
     }
 
     /**
      * @brief Prepare the GEdge data structure from two GPoint points.
      * Ensure p1.Y < p2.Y.
      */
-    void prepGEdge(GPoint p1, GPoint p2, int orientation, vector<GEdge>& edges) {
-        // printf("(%f, %f) -> (%f, %f) \n", p1.fX, p1.fY, p2.fX, p2.fY); 
+    template <typename Alloc> void prepGEdge(GPoint p1, GPoint p2, int orientation, vector<GEdge, Alloc>& edges) {
+        GEdge edge;
+        if (makeGEdge(p1, p2, orientation, &edge)) {
+            edges.push_back(edge);
+        }
+    }
+
+    /**
+     * @brief Build the GEdge for p1 -> p2 (p1.Y <= p2.Y).
+     * This is the only place edges touch floats; X is converted to 16.16 here.
+     * @return False for "narrow" edges, which cover no row center.
+     */
+    static bool makeGEdge(GPoint p1, GPoint p2, int orientation, GEdge* edge) {
         assert(p1.fY <= p2.fY);
         int top = GRoundToInt(p1.fY);
         int bot = GRoundToInt(p2.fY);
-        if (top == bot) return; // remove "narrow" edges
+        if (top == bot) return false;
 
         float m = (p1.fX - p2.fX) / (p1.fY - p2.fY);
         float b = p1.fX - m * p1.fY;
-        // printf("m = %f, b = %f \n", m, b);
-        edges.push_back(GEdge({orientation, top, bot, m, b}));        
+        // Evaluate once at the center of the top row, in double so only the final rounding to
+        // 16.16 is inexact; The scan loops only step by dx
+        GFixed x = GFloatToFixed(m * (top + 0.5) + b + 0.5);
+        *edge = GEdge({orientation, top, bot, x, GFloatToFixed(m)});
+        return true;
+    }
+
+    /**
+     * @brief Prepare a float GSegment for the anti-aliased rasterizer.
+     * Ensure p1.Y < p2.Y. Unlike GEdge, thin segments are kept, since they
+     * still contribute partial coverage.
+     */
+    template <typename Alloc> void prepGEdge(GPoint p1, GPoint p2, int orientation, vector<GSegment, Alloc>& segments) {
+        assert(p1.fY <= p2.fY);
+        if (p1.fY == p2.fY) return;
+        segments.push_back(GSegment({orientation, p1, p2}));
     }
 
     /**
      * @brief Clip edge and add the clipped edge into the list of all edges.
+     * Edges is a vector of either GEdge (aliased) or GSegment (anti-aliased).
      */
-    void clip(GPoint p1, GPoint p2, vector<GEdge>& edges) {
+    template <typename Edges> void clip(GPoint p1, GPoint p2, Edges& edges) {
         int orientation;
         p1.fY < p2.fY ? orientation = -1 : orientation = 1;
         
@@ -503,6 +1205,14 @@ private:
         }
 
         /* Horizontal Clipping */
+        // Inside the guard band the rasterizers clamp spans to the device themselves,
+        // so only edges that reach farther out are split into projected vertical pieces
+        float width = (float)fDevice.width();
+        if (std::min(p1.fX, p2.fX) >= -kGuardBand && std::max(p1.fX, p2.fX) <= width + kGuardBand) {
+            prepGEdge(p1, p2, orientation, edges);
+            return;
+        }
+
         // when prepGEdge(p3, p4, edges) is called, p3 and p4 should represent the
         // the proper newly-created vertex if clipping occurs.
         GPoint p3, p4; 
@@ -564,119 +1274,490 @@ private:
         p3.fY < p4.fY ? prepGEdge(p3, p4, orientation, edges) : prepGEdge(p4, p3, orientation, edges);
     }
 
-    void clipQuadBezierCurve(const GPoint points[], vector<GEdge>& edges) {
-        QuadBezierCurve qbc;
-        qbc.setControlPoints(points);
+    /**
+     * @brief Max distance (in device pixels) allowed between a curve and its line segments.
+     * Coverage shows flattening error directly, so anti-aliased segments get a
+     * finer tolerance than aliased edges.
+     */
+    template <typename Alloc> static float flatteningTolerance(const vector<GEdge, Alloc>&) {
+        return kFlatteningTolerance;
+    }
+    template <typename Alloc> static float flatteningTolerance(const vector<GSegment, Alloc>&) {
+        return kFlatteningTolerance / 16;
+    }
+
+    template <typename Edges> void clipQuadBezierCurve(const GPoint points[], bool needsClip, Edges& edges) {
+        QuadBezierCurve qbc(points);
+        // n equal steps in t deviate from the parabola by at most |p0 - 2 p1 + p2| / (4 n^2)
         GPoint E = (points[0] - 2 * points[1] + points[2]) * 0.25;
-        assert(tolerance - 0.25 < 0.001);
-        // Hard-coded calculation results for how many curves created through subdivisions
-        // is required for the approximation to satisfy the tolerance requirement
-        int num_segs = (int)ceil(sqrt(E.length() * (1 / tolerance)));
+        int num_segs = (int)ceil(sqrt(E.length() * (1 / flatteningTolerance(edges))));
 
-        float dt = 1.0f / num_segs;
-        float t = dt;
         GPoint p0 = points[0];
         GPoint p1;
+        qbc.begin(num_segs);
         for (int i = 1; i < num_segs; ++i) {
-            p1 = qbc.eval(t);
-            clip(p0, p1, edges);
-            t += dt;
+            p1 = qbc.next();
+            addLine(p0, p1, needsClip, edges);
             p0 = p1;
         }
         p1 = points[2];
-        clip(p0, p1, edges);
-    }
-
-    void clipCubicBezierCurve(const GPoint points[], vector<GEdge>& edges) {
-        CubicBezierCurve cbc;
-        cbc.setControlPoints(points);
-        GPoint E0 = points[0] + 2 * points[1] + points[2];
-        GPoint E1 = points[1] + 2 * points[2] + points[3];
-        GPoint E;
-        E.fX = max(abs(E0.fX), abs(E1.fX));
-        E.fY = max(abs(E0.fY), abs(E1.fY));
-        assert(tolerance - 0.25 < 0.001);
-        int num_segs = (int)ceil(sqrt((3 * E.length()) / (4 * tolerance)));
-
-        float dt = 1.0f / num_segs;
-        float t = dt;
+        addLine(p0, p1, needsClip, edges);
+    }
+
+    template <typename Edges> void clipCubicBezierCurve(const GPoint points[], bool needsClip, Edges& edges) {
+        CubicBezierCurve cbc(points);
+        // |P''| is at most 6 max(|E0|, |E1|), the larger second difference; Treating each
+        // step as a parabola with that curvature, n steps deviate by at most 3 |E| / (4 n^2)
+        GPoint E0 = points[0] - 2 * points[1] + points[2];
+        GPoint E1 = points[1] - 2 * points[2] + points[3];
+        float E = std::max(E0.length(), E1.length());
+        int num_segs = (int)ceil(sqrt((3 * E) / (4 * flatteningTolerance(edges))));
+
         GPoint p0 = points[0];
         GPoint p1;
+        cbc.begin(num_segs);
         for (int i = 1; i < num_segs; ++i) {
-            p1 = cbc.eval(t);
-            clip(p0, p1, edges);
-            t += dt;
+            p1 = cbc.next();
+            addLine(p0, p1, needsClip, edges);
             p0 = p1;
         }
         p1 = points[3];
-        clip(p0, p1, edges);
+        addLine(p0, p1, needsClip, edges);
+    }
+
+    /**
+     * @brief Add the line p1 -> p2 as an edge; Lines known to be inside the device skip clip().
+     */
+    template <typename Edges> void addLine(GPoint p1, GPoint p2, bool needsClip, Edges& edges) {
+        if (needsClip) {
+            clip(p1, p2, edges);
+        } else if (p1.fY < p2.fY) {
+            prepGEdge(p1, p2, -1, edges);
+        } else {
+            prepGEdge(p2, p1, 1, edges);
+        }
+    }
+
+    /**
+     * @brief Split a quad (count 3) or cubic (count 4) at its Y extrema.
+     * @param pieces Receives the pieces' control points; Adjacent pieces share an end point.
+     * @return Number of pieces, at most 3.
+     */
+    static int chopAtYExtrema(const GPoint points[], int count, GPoint pieces[10]) {
+        float roots[2];
+        int rootCount = 0;
+        if (count == 3) {
+            float denom = points[0].fY - 2 * points[1].fY + points[2].fY;
+            if (denom != 0) {
+                float t = (points[0].fY - points[1].fY) / denom;
+                if (t > 0 && t < 1) roots[rootCount++] = t;
+            }
+        } else {
+            // dy/dt is proportional to a t^2 + b t + c
+            float a = points[3].fY - points[0].fY + 3 * (points[1].fY - points[2].fY);
+            float b = 2 * (points[0].fY - 2 * points[1].fY + points[2].fY);
+            float c = points[1].fY - points[0].fY;
+            rootCount = unitQuadraticRoots(a, b, c, roots);
+        }
+
+        std::copy(points, points + count, pieces);
+        float prevT = 0;
+        GPoint* piece = pieces;
+        for (int i = 0; i < rootCount; i ++) {
+            // Re-map the root onto what is left of the curve
+            float t = (roots[i] - prevT) / (1 - prevT);
+            prevT = roots[i];
+            if (count == 3) {
+                GPoint src[3] = {piece[0], piece[1], piece[2]};
+                GPath::ChopQuadAt(src, piece, t);
+                // Flatten the tangents at the extremum, so float error can't undo monotonicity
+                piece[1].fY = piece[3].fY = piece[2].fY;
+            } else {
+                GPoint src[4] = {piece[0], piece[1], piece[2], piece[3]};
+                GPath::ChopCubicAt(src, piece, t);
+                piece[2].fY = piece[4].fY = piece[3].fY;
+            }
+            piece += count - 1;
+        }
+        return rootCount + 1;
+    }
+
+    /**
+     * @brief Roots of a t^2 + b t + c strictly inside (0, 1), in increasing order.
+     */
+    static int unitQuadraticRoots(float a, float b, float c, float roots[2]) {
+        float candidates[2];
+        int n = 0;
+        if (fabsf(a) < 1e-6f * (fabsf(b) + fabsf(c))) {
+            if (b != 0) candidates[n++] = -c / b;
+        } else {
+            float disc = b * b - 4 * a * c;
+            if (disc < 0) return 0;
+            // Numerically stable form; Avoids cancellation between b and the square root
+            float q = -0.5f * (b + (b < 0 ? -sqrtf(disc) : sqrtf(disc)));
+            candidates[n++] = q / a;
+            if (q != 0) candidates[n++] = c / q;
+        }
+        int count = 0;
+        for (int i = 0; i < n; i ++) {
+            if (candidates[i] > 0 && candidates[i] < 1) roots[count++] = candidates[i];
+        }
+        if (count == 2) {
+            if (roots[0] > roots[1]) std::swap(roots[0], roots[1]);
+            if (roots[0] == roots[1]) count = 1;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Add a quad (count 3) or cubic (count 4) as edges, chopped into monotonic pieces.
+     */
+    template <typename Edges> void addCurve(const GPoint points[], int count, bool needsClip, Edges& edges) {
+        // Every piece is monotonic in Y, so its control points bound it tightly
+        GPoint pieces[10];
+        int pieceCount = chopAtYExtrema(points, count, pieces);
+        for (int i = 0; i < pieceCount; i ++) {
+            addMonotonicCurve(&pieces[i * (count - 1)], count, needsClip, edges);
+        }
+    }
+
+    /**
+     * @brief Add a Y-monotonic quad or cubic as edges, culling by its control points.
+     * 
+     * A piece above or below the device adds nothing. A piece entirely left or right
+     * of it would only be projected onto the device edge line by line, which winds
+     * the same as projecting its chord, so the piece is not flattened at all.
+     */
+    template <typename Edges> void addMonotonicCurve(const GPoint points[], int count, bool needsClip, Edges& edges) {
+        if (needsClip) {
+            GRect bounds = pointBounds(points, count);
+            if (bounds.fBottom <= 0 || bounds.fTop >= fDevice.height()) return;
+            if (bounds.fRight <= 0 || bounds.fLeft >= fDevice.width()) {
+                clip(points[0], points[count - 1], edges);
+                return;
+            }
+            needsClip = (testBounds(bounds) != kInside);
+        }
+        if (count == 3) {
+            clipQuadBezierCurve(points, needsClip, edges);
+        } else {
+            clipCubicBezierCurve(points, needsClip, edges);
+        }
     }
 
     /**
-     * @brief Assemble points into edges by clipping all edges.
+     * @brief Assemble points into edges, clipping them only if needsClip.
+     * @param edges Receives the edges: a vector of GEdge or GSegment.
      */
-    vector<GEdge> assembleEdges(const GPoint points[], int count) {
-        vector<GEdge> edges;
+    template <typename Edges> void assembleEdges(const GPoint points[], int count, bool needsClip, Edges& edges) {
         for (int i = 0; i < count - 1; i ++) {
-            clip(points[i], points[i + 1], edges);
+            addLine(points[i], points[i + 1], needsClip, edges);
         }
-        clip(points[count - 1], points[0], edges);
-        return edges;
+        addLine(points[count - 1], points[0], needsClip, edges);
     }
 
     /**
-     * @brief Assemble a path into edges by clipping all edges.
+     * @brief Assemble a path into edges, clipping them only if needsClip.
+     * @param ctm Maps the path's points to device space as they are read, so the path is never
+     * copied.
+     * @param edges Receives the edges: a vector of GEdge or GSegment.
      */
-    vector<GEdge> assembleEdges(const GPath& path) {
-        vector<GEdge> edges;
+    template <typename Edges> void assembleEdges(const GPath& path, const GMatrix& ctm, bool needsClip,
+                                                 Edges& edges) {
         GPoint pts[GPath::kMaxNextPoints];
         GPath::Edger iter(path);
         GPath::Verb v;
         while ((v = iter.next(pts)) != GPath::kDone) {
             switch (v) {
                 case GPath::kLine:
-                    clip(pts[0], pts[1], edges);
+                    ctm.mapPoints(pts, 2);
+                    addLine(pts[0], pts[1], needsClip, edges);
                     break;
                 case GPath::kQuad:
-                    clipQuadBezierCurve(pts, edges);
+                    ctm.mapPoints(pts, 3);
+                    addCurve(pts, 3, needsClip, edges);
                     break;
                 case GPath::kCubic:
-                    clipCubicBezierCurve(pts, edges);
+                    ctm.mapPoints(pts, 4);
+                    addCurve(pts, 4, needsClip, edges);
                     break;
                 default:
                     break;
             }
         }
-        // printf("assembleEdges: edges.size(): %ld", edges.size());
-        return edges;
     }
 
     /**
-     * @brief Sort the [0,...,rightIdx] edges in the given edges according to
-     * their intersection with the current scan line.
+     * @brief Fill the edges using non-zero winding.
      * 
-     * @param edges ...
-     * @param currScanY the Y value of the current scan line (without _ 0.5)
-     * @param lastEdgeIdx index of the last active edge that the scan line will hit
-     */
-    void resortByCurrX(vector<GEdge>& edges, int currScanY, int lastEdgeIdx) {
-        std::sort(edges.begin(), edges.begin() + lastEdgeIdx, [=](GEdge e1, GEdge e2){
-            float x1 = e1.m * ((float)currScanY + 0.5) + e1.b;
-            float x2 = e2.m * ((float)currScanY + 0.5) + e2.b;
-            return x1 < x2;
+     * With more than one thread, each edge is binned into every tile it touches
+     * (advanced to the tile's first row), and the tiles are scanned in parallel.
+     * 
+     * @param edges Clipped edges in device space; Will be modified.
+     * @param blitter The draw's blitter.
+     */
+    void fillEdgesWinding(GArenaVector<GEdge>& edges, const GBlitter& blitter) {
+        fillEdgesWinding(edges, [&](const GSpanList& spans) {
+            blitSpans(spans, blitter);
         });
     }
 
-    bool isActive(GEdge edge, int currScanY) {
-        if (currScanY > edge.bot) {
-            // printf("here");
+    /**
+     * @brief Fill the edges using non-zero winding, handing each batch of spans to blit.
+     * Tiles may call blit concurrently.
+     */
+    template <typename Blit> void fillEdgesWinding(GArenaVector<GEdge>& edges, const Blit& blit) {
+        if (edges.empty()) return;
+        int height = fDevice.height();
+        if (pool.threadCount() == 1) {
+            scanEdgesWinding(edges, 0, height, blit);
+            return;
+        }
+
+        int tiles = (height + kTileHeight - 1) / kTileHeight;
+        GArenaVector<GArenaVector<GEdge>> bins(tiles, GArenaVector<GEdge>(scratch()), scratch());
+        for (const GEdge& e : edges) {
+            for (int t = e.top / kTileHeight; t * kTileHeight < e.bot; t ++) {
+                GEdge binned = e;
+                int tileTop = t * kTileHeight;
+                if (binned.top < tileTop) {
+                    // Same value stepping row by row would reach
+                    binned.x += (tileTop - binned.top) * binned.dx;
+                    binned.top = tileTop;
+                }
+                bins[t].push_back(binned);
+            }
         }
-        // assert(currScanY <= edge.bot);
-        return currScanY >= edge.top;
+        pool.parallelFor(tiles, [&](int t) {
+            int tileTop = t * kTileHeight;
+            scanEdgesWinding(bins[t], tileTop, std::min(tileTop + kTileHeight, height), blit);
+        });
+    }
+
+    /**
+     * @brief Scan the rows [yTop, yBot) of the edges, with an active edge table.
+     * 
+     * Edges are bucketed by their top scan line (counting sort), so each edge
+     * enters the active list exactly once. The X of every active edge is stepped
+     * incrementally by its slope, and since the active list only changes a little
+     * from one row to the next, an insertion sort keeps it ordered by X (ties by
+     * orientation, so the order never depends on where the scan started).
+     * 
+     * @param edges Edges with top in [yTop, yBot); Will be modified.
+     */
+    template <typename Blit> void scanEdgesWinding(GArenaVector<GEdge>& edges, int yTop, int yBot, const Blit& blit) {
+        if (edges.empty()) return;
+
+        // Bucket edges by their top scan line
+        GArena& arena = scratch();
+        int rows = yBot - yTop;
+        GArenaVector<int> bucketStart(rows + 1, 0, arena);
+        for (const GEdge& e : edges) {
+            assert(e.top >= yTop && e.top < yBot);
+            bucketStart[e.top - yTop + 1]++;
+        }
+        for (int r = 0; r < rows; r ++) {
+            bucketStart[r + 1] += bucketStart[r];
+        }
+        GArenaVector<GEdge*> byTop(edges.size(), nullptr, arena);
+        GArenaVector<int> fill(bucketStart.begin(), bucketStart.end() - 1, arena);
+        for (GEdge& e : edges) {
+            byTop[fill[e.top - yTop]++] = &e;
+        }
+
+        GArenaVector<GEdge*> active(arena);
+        active.reserve(edges.size());
+        GSpanList spans(clipStack.top().bounds, arena);
+        size_t next = 0;
+        int y = byTop[0]->top;
+        while (y < yBot) {
+            // Insert edges that start on this scan line
+            while (next < byTop.size() && byTop[next]->top == y) {
+                GEdge* e = byTop[next++];
+                active.push_back(e);
+            }
+
+            // Insertion sort; The active list is nearly sorted from the previous row
+            for (size_t i = 1; i < active.size(); i ++) {
+                GEdge* e = active[i];
+                size_t j = i;
+                while (j > 0 && (active[j - 1]->x > e->x ||
+                        (active[j - 1]->x == e->x && active[j - 1]->orientation > e->orientation))) {
+                    active[j] = active[j - 1];
+                    j--;
+                }
+                active[j] = e;
+            }
+
+            // Emit the spans of the scan line
+            int w = 0;
+            int left = 0;
+            for (GEdge* e : active) {
+                int x = e->currX();
+                if (w == 0) {
+                    left = x;
+                }
+                w += e->orientation;
+                if (w == 0 && x > left) {
+                    // the loop is closed
+                    spans.add(y, left, x - 1);
+                }
+            }
+            if (spans.isFull()) {
+                blit(spans);
+                spans.reset();
+            }
+
+            // Retire expired edges and step the rest to the next scan line
+            size_t kept = 0;
+            for (GEdge* e : active) {
+                if (y < e->bot - 1) {
+                    e->step();
+                    active[kept++] = e;
+                }
+            }
+            active.resize(kept);
+
+            y++;
+            if (active.empty()) {
+                // Skip the empty rows until the next edge starts
+                if (next == byTop.size()) break;
+                y = byTop[next]->top;
+            }
+        }
+        blit(spans);
+    }
+
+    /**
+     * @brief Order segments by top, as fillSegmentsAA expects.
+     */
+    template <typename Segments> static void sortSegments(Segments& segments) {
+        std::sort(segments.begin(), segments.end(), [](const GSegment& s1, const GSegment& s2) {
+            return s1.p0.fY < s2.p0.fY;
+        });
+    }
+
+    /**
+     * @brief Fill the segments with analytic anti-aliasing.
+     * 
+     * With more than one thread, the sorted segments are binned into every
+     * tile they touch and the tiles are scanned in parallel. Bins keep the
+     * sorted order, so each row accumulates in exactly the serial order.
+     * 
+     * @param segments Clipped segments in device space, sorted by sortSegments(); Any vector of GSegment.
+     * @param blitter The draw's blitter.
+     */
+    template <typename Segments> void fillSegmentsAA(const Segments& segments, const GBlitter& blitter) {
+        fillSegmentsAA(segments, [&](const GSpanList& spans) {
+            blitSpans(spans, blitter);
+        });
+    }
+
+    /**
+     * @brief Fill the segments with analytic anti-aliasing, handing each batch of spans
+     * to blit. Tiles may call blit concurrently.
+     */
+    template <typename Segments, typename Blit> void fillSegmentsAA(const Segments& segments, const Blit& blit) {
+        if (segments.empty()) return;
+        int height = fDevice.height();
+
+        if (pool.threadCount() == 1) {
+            scanSegmentsAA(segments, 0, height, blit);
+            return;
+        }
+
+        int tiles = (height + kTileHeight - 1) / kTileHeight;
+        GArenaVector<GArenaVector<GSegment>> bins(tiles, GArenaVector<GSegment>(scratch()), scratch());
+        for (const GSegment& s : segments) {
+            int first = GFloorToInt(s.p0.fY) / kTileHeight;
+            int last = std::min((GCeilToInt(s.p1.fY) - 1) / kTileHeight, tiles - 1);
+            for (int t = first; t <= last; t ++) {
+                bins[t].push_back(s);
+            }
+        }
+        pool.parallelFor(tiles, [&](int t) {
+            int tileTop = t * kTileHeight;
+            scanSegmentsAA(bins[t], tileTop, std::min(tileTop + kTileHeight, height), blit);
+        });
+    }
+
+    /**
+     * @brief Scan the rows [yTop, yBot) of the segments with analytic coverage.
+     * 
+     * Every active segment deposits the exact area it covers on the current
+     * row into a GCoverageRow; The resolved coverage is then split into runs:
+     * fully covered runs become plain spans, partially covered runs spans with
+     * coverage, and uncovered runs are skipped.
+     * 
+     * @param segments Segments sorted by top, each reaching below yTop.
+     */
+    template <typename Segments, typename Blit> void scanSegmentsAA(const Segments& segments, int yTop, int yBot,
+                                                                    const Blit& blit) {
+        if (segments.empty()) return;
+        int width = fDevice.width();
+
+        GArena& arena = scratch();
+        GCoverageRow accumulator(width, arena);
+        GArenaVector<uint8_t> coverage(width, 0, arena);
+        GArenaVector<const GSegment*> active(arena);
+        GSpanList spans(clipStack.top().bounds, arena);
+        size_t next = 0;
+        int y = std::max(yTop, GFloorToInt(segments[0].p0.fY));
+        while (y < yBot) {
+            float rowTop = (float)y;
+            float rowBot = rowTop + 1;
+            while (next < segments.size() && segments[next].p0.fY < rowBot) {
+                active.push_back(&segments[next++]);
+            }
+
+            // Accumulate the piece of each segment that falls inside this row
+            size_t kept = 0;
+            for (const GSegment* s : active) {
+                float dxdy = (s->p1.fX - s->p0.fX) / (s->p1.fY - s->p0.fY);
+                float y0 = std::max(s->p0.fY, rowTop);
+                float y1 = std::min(s->p1.fY, rowBot);
+                float x0 = s->p0.fX + (y0 - s->p0.fY) * dxdy;
+                float x1 = s->p0.fX + (y1 - s->p0.fY) * dxdy;
+                accumulator.accumulate(x0, y0 - rowTop, x1, y1 - rowTop, s->orientation);
+                if (s->p1.fY > rowBot) {
+                    active[kept++] = s;
+                }
+            }
+            active.resize(kept);
+
+            if (!accumulator.isEmpty()) {
+                int left, right;
+                accumulator.resolve(coverage.data(), &left, &right);
+                int x = left;
+                while (x <= right) {
+                    uint8_t c = coverage[x];
+                    int start = x;
+                    if (c == 0) {
+                        while (x <= right && coverage[x] == 0) x++;
+                    } else if (c == 255) {
+                        while (x <= right && coverage[x] == 255) x++;
+                        spans.add(y, start, x - 1);
+                    } else {
+                        while (x <= right && coverage[x] != 0 && coverage[x] != 255) x++;
+                        spans.addAA(y, start, x - start, &coverage[start]);
+                    }
+                }
+                if (spans.isFull()) {
+                    blit(spans);
+                    spans.reset();
+                }
+            }
+
+            y++;
+            if (active.empty()) {
+                // Skip the empty rows until the next segment starts
+                if (next == segments.size()) break;
+                y = std::max(y, GFloorToInt(segments[next].p0.fY));
+            }
+        }
+        blit(spans);
     }
-    
 
-    
     ///////////////////////////////////////////////////////////////////////////////////////////////
 
 };
@@ -685,7 +1766,12 @@ std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& device) {
     return std::unique_ptr<GCanvas>(new Canvas(device));
 }
 
-std::string GDrawSomething(GCanvas* canvas, GISize dim) {
+std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& device, int threadCount) {
+    if (threadCount < 1) return nullptr;
+    return std::unique_ptr<GCanvas>(new Canvas(device, threadCount));
+}
+
+std::string GDrawSomething(GCanvas* canvas, GISize) {
     GColor color1 = {0.5, 0.2, 0.4, 1};    
     GPaint paint1 = GPaint(color1);
     paint1.setBlendMode(GBlendMode::kDstATop);
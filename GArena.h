@@ -0,0 +1,122 @@
+#ifndef GArena_DEFINED
+#define GArena_DEFINED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/**
+ * Scratch memory for the duration of one draw: a bump allocator.
+ *
+ * Allocating is a pointer bump, freeing is a no-op (except for the most recent
+ * block, which is handed back so a growing vector can reuse it), and reset()
+ * rewinds everything at once. Allocations that do not fit spill into overflow
+ * blocks; reset() then regrows the main block to hold all of them, so after a
+ * few draws the arena settles at the size its draws need and stops touching
+ * the heap.
+ *
+ * Memory is not initialized, and destructors are never run: only hold
+ * trivially destructible data (or containers of it, via GArenaAllocator).
+ */
+class GArena {
+public:
+    explicit GArena(size_t initialBytes = 0) : used(0), capacity(0), spilled(0) {
+        grow(initialBytes);
+    }
+
+    GArena(const GArena&) = delete;
+    GArena& operator=(const GArena&) = delete;
+
+    void* allocBytes(size_t bytes, size_t align) {
+        size_t start = (used + align - 1) & ~(align - 1);
+        if (start + bytes <= capacity) {
+            used = start + bytes;
+            return block.get() + start;
+        }
+        // Spill; Overflow blocks come from the heap and are aligned like malloc
+        overflow.emplace_back(new char[bytes]);
+        spilled += bytes + align;
+        return overflow.back().get();
+    }
+
+    template <typename T> T* alloc(size_t count) {
+        return (T*)allocBytes(count * sizeof(T), alignof(T));
+    }
+
+    /**
+     * @brief Return p to the arena if it is the most recent allocation; Otherwise do nothing.
+     */
+    void free(void* p, size_t bytes) {
+        char* c = (char*)p;
+        if (c >= block.get() && c + bytes == block.get() + used) {
+            used = c - block.get();
+        }
+    }
+
+    /**
+     * @brief Where the next allocation goes, to hand to rewind later.
+     */
+    size_t mark() const { return used; }
+
+    /**
+     * @brief Free everything allocated since mark was taken; Spilled blocks stay until reset.
+     */
+    void rewind(size_t mark) {
+        if (mark < used) used = mark;
+    }
+
+    /**
+     * @brief Free every allocation; Nothing allocated before may be used afterwards.
+     */
+    void reset() {
+        used = 0;
+        if (!overflow.empty()) {
+            overflow.clear();
+            grow(capacity + spilled);
+            spilled = 0;
+        }
+    }
+
+    size_t bytesReserved() const { return capacity; }
+
+private:
+    std::unique_ptr<char[]> block;
+    size_t used, capacity;
+    std::vector<std::unique_ptr<char[]>> overflow;
+    size_t spilled; // bytes requested from overflow blocks since the last reset
+
+    void grow(size_t bytes) {
+        if (bytes <= capacity) return;
+        // new char[] is aligned for any fundamental type
+        block.reset(new char[bytes]);
+        capacity = bytes;
+    }
+};
+
+/**
+ * An STL allocator drawing from a GArena, so the rasterizer's containers keep
+ * their vector interface while living in per-draw scratch memory.
+ */
+template <typename T> class GArenaAllocator {
+public:
+    typedef T value_type;
+
+    GArenaAllocator(GArena& arena) : arena(&arena) {}
+    template <typename U> GArenaAllocator(const GArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return arena->alloc<T>(n); }
+    void deallocate(T* p, size_t n) { arena->free(p, n * sizeof(T)); }
+
+    template <typename U> bool operator==(const GArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U> bool operator!=(const GArenaAllocator<U>& other) const { return arena != other.arena; }
+
+private:
+    template <typename U> friend class GArenaAllocator;
+    GArena* arena;
+};
+
+template <typename T> using GArenaVector = std::vector<T, GArenaAllocator<T>>;
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef GBlendRowKernels_DEFINED
+#define GBlendRowKernels_DEFINED
+
+/**
+ * The body shared by the vector row blenders, written once against a vector type V:
+ *
+ *     V::N                     pixels per vector
+ *     V::load(p), V::store(p, v), V::splat(pixel)
+ *     V::coverage(bytes)       N coverage bytes, one per 32-bit lane
+ *     V::add(a, b)             32-bit lane add, wrapping like GPixel + GPixel
+ *     V::alpha(v)              each pixel's alpha, in its lane
+ *     V::inv(a)                255 - a
+ *     V::mul(v, a)             each channel times its pixel's a, / 255 rounded like div255
+ *
+ * Each translation unit that includes this compiles it for its own instruction set,
+ * so it must only be included after that unit's intrinsics, and only into code whose
+ * target matches; Everything here has internal linkage, so nothing compiled for a
+ * wider instruction set can be linked in place of a narrower copy.
+ */
+
+namespace {
+
+template <typename V, GBlendMode Mode> inline typename V::Vec blendVec(typename V::Vec s, typename V::Vec d) {
+    switch (Mode) {
+        case GBlendMode::kClear:   return V::splat(0);
+        case GBlendMode::kSrc:     return s;
+        case GBlendMode::kDst:     return d;
+        case GBlendMode::kSrcOver: return V::add(s, V::mul(d, V::inv(V::alpha(s))));
+        case GBlendMode::kDstOver: return V::add(d, V::mul(s, V::inv(V::alpha(d))));
+        case GBlendMode::kSrcIn:   return V::mul(s, V::alpha(d));
+        case GBlendMode::kDstIn:   return V::mul(d, V::alpha(s));
+        case GBlendMode::kSrcOut:  return V::mul(s, V::inv(V::alpha(d)));
+        case GBlendMode::kDstOut:  return V::mul(d, V::inv(V::alpha(s)));
+        case GBlendMode::kSrcATop: return V::add(V::mul(s, V::alpha(d)), V::mul(d, V::inv(V::alpha(s))));
+        case GBlendMode::kDstATop: return V::add(V::mul(d, V::alpha(s)), V::mul(s, V::inv(V::alpha(d))));
+        case GBlendMode::kXor:     return V::add(V::mul(d, V::inv(V::alpha(s))), V::mul(s, V::inv(V::alpha(d))));
+    }
+    return d;
+}
+
+template <typename V, GBlendMode Mode, bool SrcIsRow, bool HasCoverage>
+int blendRowVec(uint32_t* dst, const uint32_t* src, const uint8_t* coverage, int count) {
+    typedef typename V::Vec Vec;
+    int n = count - count % V::N;
+    Vec single = V::splat(SrcIsRow ? 0 : *src);
+    for (int x = 0; x < n; x += V::N) {
+        Vec s = SrcIsRow ? V::load(src + x) : single;
+        Vec d = V::load(dst + x);
+        Vec r = blendVec<V, Mode>(s, d);
+        if (HasCoverage) {
+            // Same as lerpByCoverage: mul(r, 255) is r and mul(d, 0) is 0, so full coverage needs no branch
+            Vec c = V::coverage(coverage + x);
+            r = V::add(V::mul(r, c), V::mul(d, V::inv(c)));
+        }
+        V::store(dst + x, r);
+    }
+    return n;
+}
+
+template <typename V, GBlendMode Mode>
+int blendRowVec(uint32_t* dst, const uint32_t* src, bool srcIsRow, const uint8_t* coverage, int count) {
+    if (coverage) {
+        return srcIsRow ? blendRowVec<V, Mode, true, true>(dst, src, coverage, count)
+                        : blendRowVec<V, Mode, false, true>(dst, src, coverage, count);
+    }
+    return srcIsRow ? blendRowVec<V, Mode, true, false>(dst, src, coverage, count)
+                    : blendRowVec<V, Mode, false, false>(dst, src, coverage, count);
+}
+
+template <typename V>
+int blendRowVec(GBlendMode mode, uint32_t* dst, const uint32_t* src, bool srcIsRow, const uint8_t* coverage,
+                int count) {
+    switch (mode) {
+        case GBlendMode::kClear:   return blendRowVec<V, GBlendMode::kClear>(dst, src, srcIsRow, coverage, count);
+        case GBlendMode::kSrc:     return blendRowVec<V, GBlendMode::kSrc>(dst, src, srcIsRow, coverage, count);
+        case GBlendMode::kDst:
+            // Without coverage dst is left as it is; With it, match lerpByCoverage's rounding
+            return coverage ? blendRowVec<V, GBlendMode::kDst>(dst, src, srcIsRow, coverage, count) : count;
+        case GBlendMode::kSrcOver: return blendRowVec<V, GBlendMode::kSrcOver>(dst, src, srcIsRow, coverage, count);
+        case GBlendMode::kDstOver: return blendRowVec<V, GBlendMode::kDstOver>(dst, src, srcIsRow, coverage, count);
+        case GBlendMode::kSrcIn:   return blendRowVec<V, GBlendMode::kSrcIn>(dst, src, srcIsRow, coverage, count);
+        case GBlendMode::kDstIn:   return blendRowVec<V, GBlendMode::kDstIn>(dst, src, srcIsRow, coverage, count);
+        case GBlendMode::kSrcOut:  return blendRowVec<V, GBlendMode::kSrcOut>(dst, src, srcIsRow, coverage, count);
+        case GBlendMode::kDstOut:  return blendRowVec<V, GBlendMode::kDstOut>(dst, src, srcIsRow, coverage, count);
+        case GBlendMode::kSrcATop: return blendRowVec<V, GBlendMode::kSrcATop>(dst, src, srcIsRow, coverage, count);
+        case GBlendMode::kDstATop: return blendRowVec<V, GBlendMode::kDstATop>(dst, src, srcIsRow, coverage, count);
+        case GBlendMode::kXor:     return blendRowVec<V, GBlendMode::kXor>(dst, src, srcIsRow, coverage, count);
+    }
+    return 0;
+}
+
+} // namespace
+
+#endif
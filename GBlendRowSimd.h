@@ -0,0 +1,48 @@
+#ifndef GBlendRowSimd_DEFINED
+#define GBlendRowSimd_DEFINED
+
+#include "./include/GBlendMode.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Vector row blenders: the Porter-Duff modes of GBlenders.h, several pixels at a time.
+ *
+ * Each kernel blends a row of premultiplied pixels with the same arithmetic as the
+ * scalar blenders (div255 rounding, wrapping 32-bit adds), so its output is identical
+ * bit for bit. Kernels only take whole vectors: they return how many pixels they
+ * blended, and the caller finishes the rest with the scalar blender.
+ */
+
+/**
+ * @brief Blend src into dst for count pixels, for as many whole vectors as fit.
+ * @param srcIsRow Whether src holds count pixels; Otherwise src[0] is used for every pixel.
+ * @param coverage If not null, each result is lerped back towards dst by it, as blendRowAA does.
+ * @return The number of leading pixels blended.
+ */
+typedef int (*GBlendRowSimdProc)(GBlendMode mode, uint32_t* dst, const uint32_t* src, bool srcIsRow,
+                                 const uint8_t* coverage, int count);
+
+/// @brief 4 pixels at a time; Every x86-64 CPU has SSE2.
+int GBlendRowSSE2(GBlendMode, uint32_t* dst, const uint32_t* src, bool srcIsRow, const uint8_t* coverage, int count);
+/// @brief 8 pixels at a time; Only call it when GCpuHasAVX2().
+int GBlendRowAVX2(GBlendMode, uint32_t* dst, const uint32_t* src, bool srcIsRow, const uint8_t* coverage, int count);
+
+bool GCpuHasAVX2();
+
+/// @brief The widest kernels this CPU supports, picked once at startup; Blends nothing
+/// (returns 0) where there are none.
+extern const GBlendRowSimdProc gBlendRowSimd;
+
+/// @brief Fills of at least this many bytes are too large to stay in the cache (see GFillRow).
+enum { kGStreamingFillBytes = 4 << 20 };
+
+/**
+ * @brief Set count pixels from dst to pixel, 16 bytes per store.
+ * @param streaming Use non-temporal stores, which write around the cache instead of filling it
+ * with lines that are evicted before they are read again; Only worth it for fills of at least
+ * kGStreamingFillBytes in all.
+ */
+void GFillRow(uint32_t* dst, uint32_t pixel, size_t count, bool streaming);
+
+#endif
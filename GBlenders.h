@@ -1,7 +1,10 @@
+#ifndef GBlenders_DEFINED
+#define GBlenders_DEFINED
+
 #include "./include/GPixel.h"
 #include "./include/GBlendMode.h"
 #include "./include/GMath.h"
-#include <unordered_map>
+#include "./GBlendRowSimd.h"
 
 // kClear,    //!<     0
 // kSrc,      //!<     S
@@ -19,56 +22,18 @@
 using namespace std;
 
 typedef GPixel(*blender)(const GPixel&, const GPixel&); // (GPixel src, GPixel dst)
-typedef void(*rowBlender)(int, int, GPixel*, bool, GPixel*);
-#define genRowBlender(blender) [](int left, int count, GPixel* srcPixels, bool hasShader, GPixel* dstStartAddr) { blendRow(left, count, srcPixels, hasShader, dstStartAddr, blender); }
 
 struct Blenders {
 
-    unordered_map<unsigned, rowBlender> rowBlenders;
-
-    Blenders() {
-        rowBlenders[unsigned(GBlendMode::kClear)] = genRowBlender(blendClear); 
-        rowBlenders[unsigned(GBlendMode::kSrc)] = genRowBlender(blendSrc);
-        rowBlenders[unsigned(GBlendMode::kDst)] = genRowBlender(blendDst);
-        rowBlenders[unsigned(GBlendMode::kSrcOver)] = genRowBlender(blendSrcOver);
-        rowBlenders[unsigned(GBlendMode::kDstOver)] = genRowBlender(blendDstOver);
-        rowBlenders[unsigned(GBlendMode::kSrcIn)] = genRowBlender(blendSrcIn);
-        rowBlenders[unsigned(GBlendMode::kDstIn)] = genRowBlender(blendDstIn);
-        rowBlenders[unsigned(GBlendMode::kSrcOut)] = genRowBlender(blendSrcOut);
-        rowBlenders[unsigned(GBlendMode::kDstOut)] = genRowBlender(blendDstOut);
-        rowBlenders[unsigned(GBlendMode::kSrcATop)] = genRowBlender(blendSrcATop);
-        rowBlenders[unsigned(GBlendMode::kDstATop)] = genRowBlender(blendDstATop);
-        rowBlenders[unsigned(GBlendMode::kXor)] = genRowBlender(blendXor);
-    }
-    
-    rowBlender getBlender(GBlendMode mode) {
-        return rowBlenders[unsigned(mode)];
-    }   
-
-    template <typename blender> static inline void blendRow (int left,
-      int count,
-       GPixel* srcPixels,
-        bool hasShader,
-         GPixel* dstStartAddr,
-          blender b) 
-    {
-        if (hasShader) {
-            for (int x = 0; x < count; x ++) {
-                GPixel* dstPixel = dstStartAddr + x;
-                GPixel blendedPixel = b(srcPixels[x], *dstPixel);
-                *dstPixel = blendedPixel;
-            }
-        } else {
-            GPixel srcPixel = *srcPixels;
-            for (int x = 0; x < count; x ++) {
-                GPixel* dstPixel = dstStartAddr + x;
-                GPixel blendedPixel = b(srcPixel, *dstPixel); //!! 
-                *dstPixel = blendedPixel;
-            }
-        }
+    /**
+     * @brief Return cov * src + (1 - cov) * dst, with cov in [0, 255].
+     */
+    static inline GPixel lerpByCoverage(GPixel src, GPixel dst, unsigned cov) {
+        if (cov == 255) return src;
+        return parallel_mult_diff255(src, cov) + parallel_mult_diff255(dst, 255 - cov);
     }
 
-        /**
+    /**
      * @brief Return the value of pixel * (numerator / 255).
      * Observe that operations on each of the color channel are identical. Thus, 
      * we use this function to compute them in parallel. The idea is to store bit
@@ -176,6 +141,27 @@ struct Blenders {
         + parallel_mult_diff255(src, 255 - GPixel_GetA(dst));
     }
 
+    /**
+     * @brief The blender of Mode, for loops specialized on it at compile time.
+     */
+    template <GBlendMode Mode> static inline GPixel blend(GPixel src, GPixel dst) {
+        switch (Mode) {
+            case GBlendMode::kClear:   return blendClear(src, dst);
+            case GBlendMode::kSrc:     return blendSrc(src, dst);
+            case GBlendMode::kDst:     return blendDst(src, dst);
+            case GBlendMode::kSrcOver: return blendSrcOver(src, dst);
+            case GBlendMode::kDstOver: return blendDstOver(src, dst);
+            case GBlendMode::kSrcIn:   return blendSrcIn(src, dst);
+            case GBlendMode::kDstIn:   return blendDstIn(src, dst);
+            case GBlendMode::kSrcOut:  return blendSrcOut(src, dst);
+            case GBlendMode::kDstOut:  return blendDstOut(src, dst);
+            case GBlendMode::kSrcATop: return blendSrcATop(src, dst);
+            case GBlendMode::kDstATop: return blendDstATop(src, dst);
+            case GBlendMode::kXor:     return blendXor(src, dst);
+        }
+        return dst;
+    }
+
     /**
      * Prepare source pixel from color; Called when not using a shader
     */
@@ -195,4 +181,19 @@ struct Blenders {
     }
 };
 
-
+/**
+ * @brief Blend count pixels into dst with Mode: the vector kernels take the whole vectors,
+ * and the scalar blender the rest.
+ * @param src count pixels if SrcIsRow; Otherwise src[0] is blended into every pixel.
+ * @param coverage Lerps each result back towards dst, if HasCoverage.
+ */
+template <GBlendMode Mode, bool SrcIsRow, bool HasCoverage>
+static void GBlendRow(GPixel* dst, const GPixel* src, const uint8_t* coverage, int count) {
+    int x = gBlendRowSimd(Mode, dst, src, SrcIsRow, HasCoverage ? coverage : nullptr, count);
+    for (; x < count; x ++) {
+        GPixel blended = Blenders::blend<Mode>(SrcIsRow ? src[x] : *src, dst[x]);
+        dst[x] = HasCoverage ? Blenders::lerpByCoverage(blended, dst[x], coverage[x]) : blended;
+    }
+}
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef GBlitter_DEFINED
+#define GBlitter_DEFINED
+
+#include "./GBlenders.h"
+#include "./GRasterPipeline.h"
+#include "./include/GPaint.h"
+#include "./include/GShader.h"
+#include <string.h>
+#include <algorithm>
+
+/**
+ * @brief The mode that blends a source pixel of the given alpha the same way mode does,
+ * with less work: kSrc replaces dst outright, and kDst leaves it alone.
+ * @param srcAlpha The source's alpha if all of it has the same one (0 or 255); Otherwise -1.
+ * Sources are premultiplied, so an alpha of 0 means the whole pixel is 0.
+ */
+static inline GBlendMode GReduceBlendMode(GBlendMode mode, int srcAlpha) {
+    if (srcAlpha == 255) {
+        switch (mode) {
+            case GBlendMode::kSrcOver: return GBlendMode::kSrc;
+            case GBlendMode::kDstIn:   return GBlendMode::kDst;
+            case GBlendMode::kDstOut:  return GBlendMode::kClear;
+            case GBlendMode::kSrcATop: return GBlendMode::kSrcIn;
+            case GBlendMode::kDstATop: return GBlendMode::kDstOver;
+            case GBlendMode::kXor:     return GBlendMode::kSrcOut;
+            default:                   return mode;
+        }
+    }
+    if (srcAlpha == 0) {
+        switch (mode) {
+            case GBlendMode::kSrc:
+            case GBlendMode::kSrcIn:
+            case GBlendMode::kDstIn:
+            case GBlendMode::kSrcOut:
+            case GBlendMode::kDstATop: return GBlendMode::kClear;
+            case GBlendMode::kSrcOver:
+            case GBlendMode::kDstOver:
+            case GBlendMode::kDstOut:
+            case GBlendMode::kSrcATop:
+            case GBlendMode::kXor:     return GBlendMode::kDst;
+            default:                   return mode;
+        }
+    }
+    return mode;
+}
+
+/**
+ * The shade-and-blend stage of one draw, picked once from its paint.
+ *
+ * The blend mode is first reduced by what is known of the source: the paint's
+ * color, or whether its shader is opaque. A color is blended by kernels
+ * specialized at compile time on the blend mode, on whether the source is one
+ * pixel or a row, and on whether there is coverage, so the scalar blender inlines
+ * into each loop; The vector kernels take the whole vectors first. A shader is
+ * compiled with the blend mode into a GRasterPipeline, which shades and blends
+ * each span in one pass.
+ *
+ * Sources of unknown opacity are split on the fly into runs of transparent,
+ * opaque and mixed pixels, each blended with the mode reduced for it: typically
+ * skipped, copied and blended.
+ */
+class GBlitter {
+public:
+    /**
+     * @param paint The draw's paint; Its shader, if any, must already have its context.
+     */
+    explicit GBlitter(const GPaint& paint) : shader(paint.getShader()), srcPixel(0) {
+        GBlendMode mode = paint.getBlendMode();
+        bool unknownAlpha = false;
+        if (shader != nullptr && shader->appendStages(&pipeline) && pipeline.isConstant(&srcPixel)) {
+            // A shader of one color is drawn like that color
+            kind = kColor;
+            shader = nullptr;
+            mode = GReduceBlendMode(mode, GPixel_GetA(srcPixel));
+        } else if (shader == nullptr) {
+            kind = kColor;
+            srcPixel = Blenders::prepSrcPixel(paint.getColor());
+            mode = GReduceBlendMode(mode, GPixel_GetA(srcPixel));
+        } else if (shader->isOpaque()) {
+            mode = GReduceBlendMode(mode, 255);
+            kind = kShader;
+        } else {
+            kind = kShader;
+            unknownAlpha = true;
+        }
+        init(mode, unknownAlpha);
+    }
+
+    /**
+     * @brief A blitter for rows the caller shades itself (see blendRow).
+     */
+    explicit GBlitter(GBlendMode mode) : kind(kShader), shader(nullptr), srcPixel(0) {
+        init(mode, true);
+    }
+
+    /// @brief Whether drawing changes no pixel, so the draw may be skipped.
+    bool isNoOp() const { return noOp; }
+
+    /**
+     * @brief Whether every fully covered pixel drawn is set to solidPixel(), whatever was under
+     * it, so the caller may fill the pixels without blending them.
+     */
+    bool isSolid() const { return solid; }
+    GPixel solidPixel() const { return srcPixel; }
+
+    /**
+     * @brief Shade and blend the pixels [x, x + count) of row y, which start at dst.
+     * @param coverage The pixels' coverage, or null if they are fully covered.
+     */
+    void blitSpan(int x, int y, int count, GPixel* dst, const uint8_t* coverage) const {
+        if (kind == kColor) {
+            (coverage ? procs.colorAA : procs.color)(dst, &srcPixel, coverage, count);
+        } else {
+            pipeline.run(x, y, count, dst, coverage);
+        }
+    }
+
+    /**
+     * @brief Blend count already shaded pixels into dst, scaled by coverage if it is not null.
+     */
+    void blendRow(GPixel* dst, const GPixel* src, const uint8_t* coverage, int count) const {
+        if (!classify) {
+            (coverage ? procs.rowAA : procs.row)(dst, src, coverage, count);
+            return;
+        }
+        // Classify blocks of pixels, and blend each run of blocks of one class at once.
+        // A pure run only starts after kMinRun pure blocks; Shorter ones stay with the
+        // mixed blocks around them, which the unreduced mode handles as well.
+        const Procs* current = &procs;
+        const Procs* pending = &procs;
+        int start = 0, pendingStart = 0, pendingBlocks = 0;
+        for (int x = 0; x < count; x += kBlock) {
+            int n = std::min((int)kBlock, count - x);
+            GPixel all = ~0u, any = 0;
+            for (int i = 0; i < n; i ++) {
+                all &= src[x + i];
+                any |= src[x + i];
+            }
+            const Procs* p = GPixel_GetA(any) == 0 ? &transparentProcs
+                           : GPixel_GetA(all) == 255 ? &opaqueProcs : &procs;
+            if (p == current) {
+                pendingBlocks = 0;
+                continue;
+            }
+            if (current != &procs) {
+                // A pure run ends at the first block it cannot take
+                blendRun(*current, dst, src, coverage, start, x);
+                current = &procs;
+                start = x;
+                pendingBlocks = 0;
+                if (p == current) continue;
+            }
+            if (p != pending || pendingBlocks == 0) {
+                pending = p;
+                pendingStart = x;
+                pendingBlocks = 0;
+            }
+            if (++pendingBlocks >= kMinRun) {
+                blendRun(*current, dst, src, coverage, start, pendingStart);
+                current = p;
+                start = pendingStart;
+                pendingBlocks = 0;
+            }
+        }
+        blendRun(*current, dst, src, coverage, start, count);
+    }
+
+private:
+    enum Kind { kColor, kShader };
+    typedef void (*RowProc)(GPixel* dst, const GPixel* src, const uint8_t* coverage, int count);
+
+    /// @brief The kernels of one blend mode.
+    struct Procs {
+        RowProc color, colorAA, row, rowAA;
+    };
+
+    // Pixels classified together; Short enough to find runs, long enough to keep the scan cheap
+    enum { kBlock = 8 };
+    // Pure blocks in a row needed before they are blended apart from their mixed neighbours
+    enum { kMinRun = 4 };
+
+    Kind kind;
+    GShader* shader;
+    GPixel srcPixel;
+    bool noOp;
+    bool solid;
+    bool classify;
+    Procs procs, transparentProcs, opaqueProcs;
+    GRasterPipeline pipeline;
+
+    void init(GBlendMode mode, bool unknownAlpha) {
+        if (mode == GBlendMode::kClear || mode == GBlendMode::kDst) {
+            // The source is never read, so there is nothing to shade
+            kind = kColor;
+            shader = nullptr;
+            srcPixel = 0;
+        }
+        noOp = mode == GBlendMode::kDst;
+        solid = kind == kColor && (mode == GBlendMode::kSrc || mode == GBlendMode::kClear);
+        procs = procsFor(mode);
+        classify = unknownAlpha && kind == kShader;
+        if (classify) {
+            transparentProcs = procsFor(GReduceBlendMode(mode, 0));
+            opaqueProcs = procsFor(GReduceBlendMode(mode, 255));
+        }
+        if (shader != nullptr) {
+            if (pipeline.isEmpty()) {
+                pipeline.append(GRasterPipeline::kShadeRow, shader);
+            }
+            if (classify) {
+                pipeline.appendBlend(mode, GReduceBlendMode(mode, 0), GReduceBlendMode(mode, 255));
+            } else {
+                pipeline.appendBlend(mode);
+            }
+        }
+    }
+
+    static void blendRun(const Procs& p, GPixel* dst, const GPixel* src, const uint8_t* coverage,
+                         int start, int end) {
+        if (start >= end) return;
+        if (coverage) {
+            p.rowAA(dst + start, src + start, coverage + start, end - start);
+        } else {
+            p.row(dst + start, src + start, nullptr, end - start);
+        }
+    }
+
+    static void skipRow(GPixel*, const GPixel*, const uint8_t*, int) {}
+
+    static void fillRow(GPixel* dst, const GPixel* src, const uint8_t*, int count) {
+        GFillRow(dst, *src, count, false);
+    }
+
+    static void copyRow(GPixel* dst, const GPixel* src, const uint8_t*, int count) {
+        memcpy(dst, src, count * sizeof(GPixel));
+    }
+
+    template <GBlendMode Mode> static Procs procsFor() {
+        return Procs({GBlendRow<Mode, false, false>, GBlendRow<Mode, false, true>,
+                      GBlendRow<Mode, true, false>, GBlendRow<Mode, true, true>});
+    }
+
+    static Procs procsFor(GBlendMode mode) {
+        switch (mode) {
+            case GBlendMode::kClear: {
+                Procs p = procsFor<GBlendMode::kClear>();
+                p.color = fillRow;
+                return p;
+            }
+            case GBlendMode::kSrc: {
+                Procs p = procsFor<GBlendMode::kSrc>();
+                p.color = fillRow;
+                p.row = copyRow;
+                return p;
+            }
+            case GBlendMode::kDst:     return Procs({skipRow, skipRow, skipRow, skipRow});
+            case GBlendMode::kSrcOver: return procsFor<GBlendMode::kSrcOver>();
+            case GBlendMode::kDstOver: return procsFor<GBlendMode::kDstOver>();
+            case GBlendMode::kSrcIn:   return procsFor<GBlendMode::kSrcIn>();
+            case GBlendMode::kDstIn:   return procsFor<GBlendMode::kDstIn>();
+            case GBlendMode::kSrcOut:  return procsFor<GBlendMode::kSrcOut>();
+            case GBlendMode::kDstOut:  return procsFor<GBlendMode::kDstOut>();
+            case GBlendMode::kSrcATop: return procsFor<GBlendMode::kSrcATop>();
+            case GBlendMode::kDstATop: return procsFor<GBlendMode::kDstATop>();
+            case GBlendMode::kXor:     return procsFor<GBlendMode::kXor>();
+        }
+        return procsFor<GBlendMode::kSrcOver>();
+    }
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef GClipMask_DEFINED
+#define GClipMask_DEFINED
+
+#include "./include/GRect.h"
+#include <stdint.h>
+#include <vector>
+
+/**
+ * An A8 clip: the coverage (0 - 255) of every device pixel inside bounds.
+ * Pixels outside bounds are clipped out entirely.
+ */
+struct GClipMask {
+    GIRect bounds;
+    std::vector<uint8_t> alpha; // bounds.width() bytes per row
+
+    GClipMask(const GIRect& bounds) : bounds(bounds), alpha((size_t)bounds.width() * bounds.height(), 0) {}
+
+    /**
+     * @brief Coverage of device pixel (x, y), which must be inside bounds.
+     */
+    uint8_t* getAddr(int x, int y) {
+        return &alpha[(size_t)(y - bounds.fTop) * bounds.width() + (x - bounds.fLeft)];
+    }
+    const uint8_t* getAddr(int x, int y) const {
+        return &alpha[(size_t)(y - bounds.fTop) * bounds.width() + (x - bounds.fLeft)];
+    }
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef GCoverage_DEFINED
+#define GCoverage_DEFINED
+
+#include "./include/GPoint.h"
+#include "./GArena.h"
+
+/**
+ * A clipped line segment in device space, kept in float so the anti-aliased
+ * rasterizer can compute exact area coverage. p0 is always the top end.
+ */
+struct GSegment {
+    int orientation;
+    GPoint p0, p1;
+};
+
+/**
+ * Scan line accumulation buffer for analytic coverage.
+ *
+ * Each segment piece inside the row deposits the signed area it covers to its
+ * right into acc[]; A prefix sum over acc[] then gives the exact area of every
+ * pixel covered by the shape (non-zero winding: |sum| clamped to 1).
+ * The one approximation: a pixel holding both positive and negative winding
+ * (where oppositely wound contours cross) gets the net of the two areas.
+ */
+class GCoverageRow {
+public:
+    GCoverageRow(int width, GArena& arena) : width(width), acc(width + 2, 0.0f, arena),
+        minX(width + 1), maxX(-1) {}
+
+    /**
+     * @brief Accumulate a piece of a segment that lies inside the current row.
+     * @param x0,y0 Start of the piece; y is relative to the top of the row, in [0, 1].
+     * @param x1,y1 End of the piece; x is clipped to [0, width].
+     * @param dir Winding direction of the segment (+1 or -1).
+     */
+    void accumulate(float x0, float y0, float x1, float y1, int dir) {
+        float d = (y1 - y0) * dir;
+        if (d == 0) return;
+        if (x1 < x0) {
+            std::swap(x0, x1);
+        }
+        int x0i = (int)floorf(x0);
+        int x1i = (int)ceilf(x1);
+        if (x1i <= x0i + 1) {
+            // The piece stays within a single pixel column
+            float xmf = 0.5f * (x0 + x1) - x0i;
+            add(x0i, d - d * xmf);
+            add(x0i + 1, d * xmf);
+        } else {
+            // Spread the area over the pixel columns the piece crosses
+            float s = 1.0f / (x1 - x0);
+            float x0f = x0 - x0i;
+            float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+            float x1f = x1 - x1i + 1.0f;
+            float am = 0.5f * s * x1f * x1f;
+            add(x0i, d * a0);
+            if (x1i == x0i + 2) {
+                add(x0i + 1, d * (1.0f - a0 - am));
+            } else {
+                float a1 = s * (1.5f - x0f);
+                add(x0i + 1, d * (a1 - a0));
+                for (int xi = x0i + 2; xi < x1i - 1; xi ++) {
+                    add(xi, d * s);
+                }
+                float a2 = a1 + (x1i - x0i - 3) * s;
+                add(x1i - 1, d * (1.0f - a2 - am));
+            }
+            add(x1i, d * am);
+        }
+    }
+
+    bool isEmpty() const { return maxX < minX; }
+
+    /**
+     * @brief Convert the accumulated row into 8-bit coverage and reset the buffer.
+     * @param coverage Receives coverage for pixels [left, right].
+     * @param left [Out] Left-most pixel touched by the row.
+     * @param right [Out] Right-most pixel touched by the row.
+     */
+    void resolve(uint8_t coverage[], int* left, int* right) {
+        int l = std::max(minX, 0);
+        int r = std::min(maxX, width - 1);
+        float sum = 0;
+        for (int x = l; x <= r; x ++) {
+            sum += acc[x];
+            float c = std::min(fabsf(sum), 1.0f);
+            coverage[x] = (uint8_t)(c * 255 + 0.5f);
+        }
+        std::fill(acc.begin() + minX, acc.begin() + maxX + 1, 0.0f);
+        *left = l;
+        *right = r;
+        minX = width + 1;
+        maxX = -1;
+    }
+
+private:
+    int width;
+    GArenaVector<float> acc;
+    int minX, maxX; // range of acc[] touched since the last resolve
+
+    void add(int x, float area) {
+        if (x < 0) x = 0;
+        if (x > width + 1) x = width + 1;
+        acc[x] += area;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+    }
+};
+
+#endif
@@ -1,27 +1,43 @@
+#ifndef GEdge_DEFINED
+#define GEdge_DEFINED
+
+#include <math.h>
+#include <stdint.h>
+
+/**
+ * 16.16 fixed point: the high 16 bits hold the integer part, and the low
+ * 16 bits hold the fraction.
+ */
+typedef int32_t GFixed;
+
+#define GFIXED_SHIFT 16
+#define GFIXED_ONE (1 << GFIXED_SHIFT)
+#define GFIXED_HALF (1 << (GFIXED_SHIFT - 1))
+
+static inline GFixed GFloatToFixed(double x) {
+    // Keep the value representable; only single-row edges get near this.
+    const double kMax = 32767.0;
+    if (x > kMax) x = kMax;
+    if (x < -kMax) x = -kMax;
+    // Round to nearest; Truncating toward zero would move every edge left of 0 to the right
+    return (GFixed)lrint(x * GFIXED_ONE);
+}
+
 struct GEdge {
     int orientation;
     int top, bot;
-    float m, b; // x = m * y + b
-
-    // bool operator()(const GEdge& e1, const GEdge& e2) {
-    //     if (e1.top == e2.top) {
-    //         return e1.bot < e2.bot;
-    //     } else return e1.top < e2.top;
-    // }
-    // /**
-    //  * @brief Compare two edges first by Y value then by X value.
-    //  * Highest-ranked edge should be located at top left.
-    //  * @param e1 Edge 1.
-    //  * @param e2 Edge 2.
-    //  * @return true if Edge 1 is ranked higher then Edge 2.
-    //  * @return false if otherwise.
-    //  */
-    // bool operator()(const GEdge& e1, const GEdge& e2){
-    //     if (e1.ITopY == e2.ITopY) {
-    //         if (e1.IBotY == e2.IBotY) {
-    //             if (e1.ITopX == e2.ITopX) return e1.IBotX < e2.IBotX;
-    //             else return e1.ITopX < e2.ITopX;
-    //         } else return e1.IBotY < e2.IBotY;
-    //     } else return e1.ITopY < e2.ITopY;
-    // }
-};
\ No newline at end of file
+    GFixed x;  // x + 0.5 at the center of the current scan line, so x >> 16 is the rounded pixel
+    GFixed dx; // change in x per scan line
+
+    /**
+     * @brief Rounded X of the edge on the current scan line.
+     */
+    int currX() const { return x >> GFIXED_SHIFT; }
+
+    /**
+     * @brief Move the edge down to the next scan line.
+     */
+    void step() { x += dx; }
+};
+
+#endif
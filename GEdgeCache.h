@@ -0,0 +1,131 @@
+#ifndef GEdgeCache_DEFINED
+#define GEdgeCache_DEFINED
+
+#include "./include/GMatrix.h"
+#include <stdint.h>
+#include <string.h>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * What a path's device-space edges depend on, for one canvas: its contents and the CTM.
+ */
+struct GEdgeCacheKey {
+    uint64_t pathID;
+    float matrix[6];
+
+    GEdgeCacheKey(uint64_t pathID, const GMatrix& ctm) : pathID(pathID) {
+        for (int i = 0; i < 6; i ++) matrix[i] = ctm[i];
+    }
+
+    bool operator==(const GEdgeCacheKey& other) const {
+        // Compare the matrix bitwise, to agree with the hash
+        return pathID == other.pathID && !memcmp(matrix, other.matrix, sizeof(matrix));
+    }
+};
+
+struct GEdgeCacheKeyHash {
+    size_t operator()(const GEdgeCacheKey& key) const {
+        uint32_t words[6];
+        memcpy(words, key.matrix, sizeof(words));
+        size_t h = key.pathID;
+        for (uint32_t w : words) {
+            h = h * 31 + w;
+        }
+        return h;
+    }
+};
+
+/**
+ * A bounded LRU cache of edge lists, owned by one canvas and used only on its drawing thread.
+ *
+ * A list is only admitted on its key's second miss, so paths drawn once don't evict the ones
+ * being redrawn. The keys that missed lately are kept in a ring as long as the capacity.
+ */
+template <typename Edge> class GEdgeCache {
+public:
+    GEdgeCache(int capacity) : capacity(0), nextMiss(0), hitCount(0), missCount(0) {
+        setCapacity(capacity);
+    }
+
+    /**
+     * @brief Return the cached list for key and mark it most recently used, or null.
+     * The list stays valid until the next insert or setCapacity.
+     */
+    const std::vector<Edge>* find(const GEdgeCacheKey& key) {
+        auto found = index.find(key);
+        if (found == index.end()) {
+            missCount++;
+            return nullptr;
+        }
+        hitCount++;
+        entries.splice(entries.begin(), entries, found->second);
+        return &found->second->second;
+    }
+
+    /**
+     * @brief Copy a list in as the most recently used, if its key missed lately; Otherwise just
+     * remember that it missed.
+     */
+    template <typename Iter> void insert(const GEdgeCacheKey& key, Iter begin, Iter end) {
+        if (capacity == 0 || index.count(key)) return;
+        if (!forgetMiss(key)) {
+            rememberMiss(key);
+            return;
+        }
+        entries.emplace_front(key, std::vector<Edge>(begin, end));
+        index[key] = entries.begin();
+        evict();
+    }
+
+    void setCapacity(int newCapacity) {
+        capacity = newCapacity;
+        evict();
+        recentMisses.clear();
+        recentMisses.reserve(capacity);
+        nextMiss = 0;
+    }
+
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+    int count() const { return (int)entries.size(); }
+
+private:
+    typedef std::pair<GEdgeCacheKey, std::vector<Edge>> Entry;
+
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<GEdgeCacheKey, typename std::list<Entry>::iterator, GEdgeCacheKeyHash> index;
+    std::vector<GEdgeCacheKey> recentMisses; // never grows past capacity
+    int capacity;
+    int nextMiss;
+    uint64_t hitCount, missCount;
+
+    void rememberMiss(const GEdgeCacheKey& key) {
+        if ((int)recentMisses.size() < capacity) {
+            recentMisses.push_back(key);
+        } else {
+            recentMisses[nextMiss] = key;
+            nextMiss = (nextMiss + 1) % capacity;
+        }
+    }
+
+    bool forgetMiss(const GEdgeCacheKey& key) {
+        for (GEdgeCacheKey& missed : recentMisses) {
+            if (missed == key) {
+                missed.pathID = 0; // No path has ID 0
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void evict() {
+        while ((int)entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef GQuadLevel_DEFINED
+#define GQuadLevel_DEFINED
+
+#include "./include/GColor.h"
+#include "./include/GPoint.h"
+#include <algorithm>
+#include <math.h>
+
+/**
+ * Automatic level of detail for drawQuad.
+ *
+ * A quad is the bilinear patch
+ *     P(s, t) = p0 + (p1 - p0) s + (p3 - p0) t + (p0 - p1 + p2 - p3) s t
+ * and splitting it into k x k cells of two triangles each is off by at most
+ * |p0 - p1 + p2 - p3| / (4 k^2) anywhere: the twist term is all the triangles
+ * miss, and it is largest at a cell's center. The same holds for the corner
+ * colors and texture coordinates, which are interpolated the same way.
+ */
+
+// Most subdivision picked automatically; Quads past this are huge and warped
+static const int kMaxAutoQuadLevel = 127;
+// Smallest cell side (in pixels) worth subdividing down to
+static const float kMinAutoQuadCell = 2.0f;
+
+/// @brief Cells per side so that an error of twist / (4 k^2) stays within maxError.
+static inline float quadCellsForTwist(float twist, float maxError) {
+    return sqrtf(twist / (4 * maxError));
+}
+
+/**
+ * @brief Pick the drawQuad level for a quad, from its size and shape on the device.
+ * @param deviceVerts The corners, already mapped to device space.
+ * @param colors,texs The corners' payloads; Either may be null.
+ * @param maxError Budget, in pixels, for how far the triangles may stray from the
+ * true quad. Color errors are counted in 8-bit steps, and texture errors in texels
+ * scaled to the quad's size on the device, against the same budget.
+ */
+static inline int GComputeQuadLevel(const GPoint deviceVerts[4], const GColor colors[4], const GPoint texs[4],
+                                    float maxError) {
+    const GPoint* p = deviceVerts;
+    float cells = quadCellsForTwist((p[0] - p[1] + p[2] - p[3]).length(), maxError);
+
+    if (colors != nullptr) {
+        GColor twist = colors[0] - colors[1] + colors[2] - colors[3];
+        float steps = 255 * std::max(std::max(fabsf(twist.r), fabsf(twist.g)),
+                                     std::max(fabsf(twist.b), fabsf(twist.a)));
+        cells = std::max(cells, quadCellsForTwist(steps, maxError));
+    }
+
+    float longestSide = 0;
+    for (int i = 0; i < 4; i ++) {
+        longestSide = std::max(longestSide, (p[(i + 1) % 4] - p[i]).length());
+    }
+    if (texs != nullptr) {
+        float longestTexSide = 0;
+        for (int i = 0; i < 4; i ++) {
+            longestTexSide = std::max(longestTexSide, (texs[(i + 1) % 4] - texs[i]).length());
+        }
+        if (longestTexSide > 0) {
+            float twist = (texs[0] - texs[1] + texs[2] - texs[3]).length();
+            cells = std::max(cells, quadCellsForTwist(twist * longestSide / longestTexSide, maxError));
+        }
+    }
+
+    // Cells only a pixel or so across have no detail left to show; This is what
+    // collapses small quads to 2 triangles
+    cells = std::min(cells, longestSide / kMinAutoQuadCell);
+    if (!(cells > 1)) return 0; // also catches NaN from a non-finite quad
+    return std::min((int)ceilf(cells) - 1, kMaxAutoQuadLevel);
+}
+
+#endif
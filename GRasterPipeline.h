@@ -0,0 +1,135 @@
+#ifndef GRasterPipeline_DEFINED
+#define GRasterPipeline_DEFINED
+
+#include "./include/GBlendMode.h"
+#include "./include/GMatrix.h"
+#include "./include/GPixel.h"
+#include "./include/GShader.h"
+#include <stdint.h>
+
+/// @brief What the bitmap stages read: the pixels, the size they tile to, and where they are.
+struct GPipelineBitmap {
+    const GPixel* pixels;
+    int rowPixels;   // rowBytes / 4
+    int width, height;
+    const GMatrix* inverse;  // device to bitmap coordinates
+};
+
+/// @brief What the gradient stage reads: colors[0] at t = 0 ... colors[count - 1] at t = 1.
+struct GPipelineGradient {
+    // colors[count] must be readable too: at t = 1 it is read, with weight 0
+    const GColor* colors;
+    int count;
+};
+
+/**
+ * Shades and blends a draw's rows through a short list of stages, a block of
+ * kLanes pixels at a time.
+ *
+ * A shader appends the stages that compute its colors (see GShader::appendStages);
+ * appendBlend then adds the one that blends them into dst. Each stage works on
+ * the whole block before the next one runs, so its loop is short and simple
+ * enough to vectorize, and the block stays in the cache from the first stage to
+ * the last: there is no shaded row written out and read back.
+ *
+ * Stages work at one of two precisions. Gradient coordinates and colors are
+ * highp: floats, computed with the same expressions as the scalar shaders, so
+ * both give the same pixels. The source is lowp: premultiplied GPixels, which the
+ * blend stage widens to 16-bit lanes in the vector row blenders (GBlendRowSimd.h),
+ * the same kernels solid colors are blended with. The bitmap stages go straight
+ * to lowp: they step their coordinates in 32.32 fixed point, and read the texels
+ * with loops specialized on the tile mode and on whether the span is scaled,
+ * rotated, or neither.
+ *
+ * The lowp lanes are packed 8888 pixels, not planar 16-bit channels: texels and
+ * dst are stored 8888, and the row blenders already widen each vector to 16 bits
+ * per channel in registers. A planar 16-bit SrcOver stage (AVX2, same rounding)
+ * had to unpack src and dst and pack the result, and made bitmap_alpha slower:
+ * 7.45 ms against 5.37 ms, medians of 8 runs.
+ */
+class GRasterPipeline {
+public:
+    enum { kLanes = 16, kMaxStages = 6 };
+
+    enum Stage {
+        // highp
+        kSeed,            // ctx: const GMatrix*, the device to shader inverse; x, y = mapped pixel centers
+        kGradientClamp,   // x = t in [0, 1]
+        kGradientRepeat,
+        kGradientMirror,
+        kGradient,        // ctx: const GPipelineGradient*; r, g, b, a = the unpremultiplied color at t = x
+        kPremul,          // src = r, g, b, a as premultiplied bytes, rounded like Blenders::prepSrcPixel
+        // lowp
+        kBitmapClamp,     // ctx: const GPipelineBitmap*; src = the texels under the pixel centers, tiled
+        kBitmapRepeat,
+        kBitmapMirror,
+        kConstant,        // ctx: const GPixel*; src = that pixel
+        kShadeRow,        // ctx: GShader*; src = its shadeRow, for shaders without stages
+        kStageCount
+    };
+
+    GRasterPipeline() : blends(), classify(false) {}
+
+    /// @brief Add a stage that computes the source; ctx must outlive the pipeline's runs.
+    void append(Stage stage, const void* ctx = nullptr) {
+        shade.append(stage, ctx);
+    }
+
+    /// @brief Finish the pipeline: blend the source into dst with mode, lerped by the
+    /// coverage if there is some.
+    void appendBlend(GBlendMode mode) {
+        blends[kMixed] = mode;
+        classify = false;
+    }
+
+    /**
+     * @brief Finish the pipeline like appendBlend(mode), but blend blocks whose source is
+     * all transparent or all opaque with the modes reduced for them (see GReduceBlendMode).
+     */
+    void appendBlend(GBlendMode mode, GBlendMode transparentMode, GBlendMode opaqueMode) {
+        blends[kMixed] = mode;
+        blends[kTransparent] = transparentMode;
+        blends[kOpaque] = opaqueMode;
+        classify = true;
+    }
+
+    /// @brief If the shader's only stage is kConstant, its pixel.
+    bool isConstant(GPixel* pixel) const {
+        if (shade.count != 1 || shade.stages[0] != kConstant) return false;
+        *pixel = *(const GPixel*)shade.contexts[0];
+        return true;
+    }
+
+    bool isEmpty() const { return shade.count == 0; }
+
+    /**
+     * @brief Shade and blend the pixels [x, x + count) of row y, which start at dst.
+     * @param coverage The pixels' coverage, or null if they are fully covered.
+     */
+    void run(int x, int y, int count, GPixel* dst, const uint8_t* coverage) const;
+
+    /// @brief Shade the pixels [x, x + count) of row y into row, without blending them.
+    void shadeRow(int x, int y, int count, GPixel row[]) const;
+
+private:
+    enum { kMixed, kTransparent, kOpaque };
+
+    struct Program {
+        int count = 0;
+        Stage stages[kMaxStages];
+        const void* contexts[kMaxStages];
+
+        void append(Stage stage, const void* ctx) {
+            assert(count < kMaxStages);
+            stages[count] = stage;
+            contexts[count] = ctx;
+            count += 1;
+        }
+    };
+
+    Program shade;
+    GBlendMode blends[3];  // by the class of the block's source alpha, if classify
+    bool classify;
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef GSpan_DEFINED
+#define GSpan_DEFINED
+
+#include "./GArena.h"
+#include "./include/GRect.h"
+#include <stdint.h>
+#include <algorithm>
+
+/**
+ * A horizontal run of pixels [x, x + count) on row y, produced by a rasterizer.
+ * coverage is -1 for a fully covered run, otherwise the offset of the run's
+ * per-pixel coverage in its GSpanList.
+ */
+struct GSpan {
+    int y;
+    int x;
+    int count;
+    int coverage;
+};
+
+/**
+ * The output of one rasterizer pass: the spans of a primitive, in scan order.
+ *
+ * Rasterizers only append; A separate blit stage then shades and blends the
+ * whole list at once, so the per-span setup (blender lookup, shader checks,
+ * scratch buffers) is paid once per batch instead of once per span. A
+ * primitive's spans never overlap, so blitting them later, or in several
+ * batches, gives the same pixels as blitting each one as it is found.
+ */
+class GSpanList {
+public:
+    /**
+     * @param clip The rectangle spans are trimmed to: the device, or the canvas' clip bounds.
+     * This is where a rectangular clip is applied, at no cost per pixel.
+     * @param arena Holds the spans; Must outlive the list.
+     */
+    GSpanList(const GIRect& clip, GArena& arena) : clip(clip), spans(arena), coverageBytes(arena), longest(0) {}
+
+    /**
+     * @brief Add the fully covered pixels [left, right] of row y, trimmed to the clip.
+     */
+    void add(int y, int left, int right) {
+        if (y < clip.fTop || y >= clip.fBottom) return;
+        left = std::max(left, clip.fLeft);
+        right = std::min(right, clip.fRight - 1);
+        if (left > right) return;
+        spans.push_back(GSpan({y, left, right - left + 1, -1}));
+        longest = std::max(longest, right - left + 1);
+    }
+
+    /**
+     * @brief Add count partially covered pixels from (x, y), trimmed to the clip; coverage is copied.
+     */
+    void addAA(int y, int x, int count, const uint8_t coverage[]) {
+        if (y < clip.fTop || y >= clip.fBottom) return;
+        int left = std::max(x, clip.fLeft);
+        int right = std::min(x + count, clip.fRight);
+        if (left >= right) return;
+        coverage += left - x;
+        count = right - left;
+        spans.push_back(GSpan({y, left, count, (int)coverageBytes.size()}));
+        coverageBytes.insert(coverageBytes.end(), coverage, coverage + count);
+        longest = std::max(longest, count);
+    }
+
+    const GArenaVector<GSpan>& getSpans() const { return spans; }
+    const uint8_t* getCoverage(const GSpan& span) const { return &coverageBytes[span.coverage]; }
+
+    /**
+     * @brief The widest span; Lets the blit stage size one scratch row for all of them.
+     */
+    int maxCount() const { return longest; }
+
+    bool isEmpty() const { return spans.empty(); }
+
+    /**
+     * @brief Whether the list has grown enough that it should be blitted and reset
+     * before rasterizing further, to bound its memory.
+     */
+    bool isFull() const {
+        return spans.size() >= kMaxSpans || coverageBytes.size() >= kMaxCoverageBytes;
+    }
+
+    void reset() {
+        spans.clear();
+        coverageBytes.clear();
+        longest = 0;
+    }
+
+private:
+    static const size_t kMaxSpans = 4096;
+    static const size_t kMaxCoverageBytes = 64 * 1024;
+
+    GIRect clip;
+    GArenaVector<GSpan> spans;
+    GArenaVector<uint8_t> coverageBytes;
+    int longest;
+};
+
+#endif
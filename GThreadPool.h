@@ -0,0 +1,129 @@
+#ifndef GThreadPool_DEFINED
+#define GThreadPool_DEFINED
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A small pool of worker threads for running independent jobs (tiles) in parallel.
+ *
+ * Jobs are claimed one at a time from a shared atomic counter, so a thread that
+ * finishes its tile early immediately takes the next unclaimed one; Uneven tiles
+ * balance out without any up-front assignment. The calling thread works too.
+ */
+class GThreadPool {
+public:
+    /**
+     * @param threadCount Total threads that run jobs, including the calling thread.
+     */
+    GThreadPool(int threadCount) : job(nullptr), jobCount(0), nextJob(0), busyWorkers(0),
+        generation(0), quit(false)
+    {
+        for (int i = 1; i < threadCount; i ++) {
+            workers.push_back(std::thread([this, i]() { workerLoop(i); }));
+        }
+    }
+
+    ~GThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+    int threadCount() const { return (int)workers.size() + 1; }
+
+    /**
+     * @brief Index of the calling thread in this pool, in [0, threadCount); 0 for the
+     * thread that calls parallelFor, and for any thread that is not one of this pool's
+     * workers, even a worker of another pool. Lets jobs pick per-thread scratch.
+     */
+    int threadIndex() const {
+        const Slot& slot = currentSlot();
+        return slot.pool == this ? slot.index : 0;
+    }
+
+    /**
+     * @brief Run fn(0) ... fn(count - 1) across the pool; Return once all have finished.
+     */
+    template <typename F> void parallelFor(int count, const F& fn) {
+        if (workers.empty() || count <= 1) {
+            for (int i = 0; i < count; i ++) fn(i);
+            return;
+        }
+        // Wrapping a reference never allocates, unlike a std::function holding a large lambda
+        std::function<void(int)> wrapped(std::cref(fn));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &wrapped;
+            jobCount = count;
+            nextJob = 0;
+            busyWorkers = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        runJobs();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake; // signals workers that a new batch is ready
+    std::condition_variable done; // signals the caller that every worker is idle
+
+    const std::function<void(int)>* job;
+    int jobCount;
+    std::atomic<int> nextJob;
+    int busyWorkers;
+    unsigned long generation; // bumped once per parallelFor
+    bool quit;
+
+    void runJobs() {
+        for (int i = nextJob++; i < jobCount; i = nextJob++) {
+            (*job)(i);
+        }
+    }
+
+    // The pool a worker thread belongs to, and its index there
+    struct Slot {
+        const GThreadPool* pool;
+        int index;
+    };
+
+    static Slot& currentSlot() {
+        static thread_local Slot slot = {nullptr, 0};
+        return slot;
+    }
+
+    void workerLoop(int index) {
+        currentSlot() = {this, index};
+        unsigned long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return quit || generation != seen; });
+                if (quit) return;
+                seen = generation;
+            }
+            runJobs();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--busyWorkers == 0) done.notify_one();
+            }
+        }
+    }
+};
+
+#endif
@@ -2,6 +2,20 @@
 #include "./include/GMatrix.h"
 #include "./include/GColor.h"
 #include "./GBlenders.h"
+#include "./GRasterPipeline.h"
+
+/// @brief Append the stages of a gradient along x in [0, 1], with the given colors.
+static void appendGradientStages(GRasterPipeline* p, const GMatrix* m, GShader::TileMode mode,
+                                 const GPipelineGradient* gradient) {
+    p->append(GRasterPipeline::kSeed, m);
+    switch (mode) {
+        case GShader::kClamp:  p->append(GRasterPipeline::kGradientClamp);  break;
+        case GShader::kRepeat: p->append(GRasterPipeline::kGradientRepeat); break;
+        case GShader::kMirror: p->append(GRasterPipeline::kGradientMirror); break;
+    }
+    p->append(GRasterPipeline::kGradient, gradient);
+    p->append(GRasterPipeline::kPremul);
+}
 
 class LinearGradientShader : public GShader {
 public:
@@ -24,7 +38,7 @@ public:
     }
 
     bool isOpaque() {
-        for (int i = 0; i < numOfColors - 1; i ++) {
+        for (int i = 0; i < numOfColors; i ++) {
             if (colors[i].a != 1) return false;
         }
         return true;
@@ -80,12 +94,19 @@ public:
         }
     }
 
+    bool appendStages(GRasterPipeline* p) override {
+        pipelineGradient = {colors, numOfColors};
+        appendGradientStages(p, &m, mode, &pipelineGradient);
+        return true;
+    }
+
 private:
     GColor colors[10]; // pre-allocate to 10
     int numOfColors;
     GMatrix m; // Matrix to use
     GMatrix T_gradient; // Matrix that transform from world space to gradient-line space
     GShader::TileMode mode;
+    GPipelineGradient pipelineGradient;
 
     GColor interpolate(GColor start, GColor end, float w) {
         float ew = 1 - w;
@@ -110,7 +131,7 @@ public:
     }
 
     bool isOpaque() {
-        return false; // we don't care, always return the prepared pixel
+        return GPixel_GetA(p) == 255;
     }
 
     bool setContext(const GMatrix& ctm) override {
@@ -123,6 +144,11 @@ public:
         }
     }
 
+    bool appendStages(GRasterPipeline* pipeline) override {
+        pipeline->append(GRasterPipeline::kConstant, &p);
+        return true;
+    }
+
 private:
     GPixel p;
 };
@@ -143,6 +169,7 @@ public:
 
         colors[0] = c[0];
         colors[1] = c[1];
+        colors[2] = c[1];
         left = Blenders::prepSrcPixel(colors[0]);
         right = Blenders::prepSrcPixel(colors[1]);
 
@@ -172,11 +199,11 @@ public:
                     cix = ix;
                     if (ix >= 1.0f) {
                         row[j] = right;
-                        return;
+                        continue;
                     }
                     if (ix <= 0.0f) {
                         row[j] = left;
-                        return;
+                        continue;
                     }
                     break;
                 }
@@ -200,6 +227,12 @@ public:
         }
     }
 
+    bool appendStages(GRasterPipeline* p) override {
+        pipelineGradient = {colors, numOfColors};
+        appendGradientStages(p, &m, mode, &pipelineGradient);
+        return true;
+    }
+
 private:
     GColor colors[10]; // pre-allocate to 10
     int numOfColors;
@@ -208,6 +241,7 @@ private:
     GPixel left;
     GPixel right;
     GShader::TileMode mode;
+    GPipelineGradient pipelineGradient;
 
     GColor interpolate(float ix) {
         float c = 1.0f - ix;
@@ -125,12 +125,12 @@ void GPath::addPolygon(const GPoint pts[], int count) {
 }
 
 GRect GPath::bounds() const {
-    if (this->fPts.size() == 1) return GRect::XYWH(fPts[0].fX, fPts[0].fY, 0, 0); //!! ?????
+    if (this->fPts.empty()) return GRect::LTRB(0, 0, 0, 0);
 
-    float left = 0;
-    float right = 0;
-    float top = 0;
-    float bot = 0;
+    float left = fPts[0].fX;
+    float right = fPts[0].fX;
+    float top = fPts[0].fY;
+    float bot = fPts[0].fY;
 
     for (GPoint p : this->fPts) {
         left = std::min(left, p.fX);
@@ -146,6 +146,7 @@ void GPath::transform(const GMatrix& ctm) {
     //     printf("Pre-trans pts[0] = (%f, %f) \n", this->fPts[i].fX, this->fPts[i].fY);
     // }
     ctm.mapPoints(this->fPts.data(), this->fPts.size());
+    this->changed();
     // for (int i = 0; i < this->fPts.size(); i ++) {
     //     printf("Path to draw: pts[%d] = (%f, %f) \n", i, this->fPts[i].fX, this->fPts[i].fY);
     // }
@@ -0,0 +1,778 @@
+#include "./include/GPicture.h"
+#include "./include/GPath.h"
+#include "./include/GShader.h"
+#include "./include/GRect.h"
+#include "./GQuadLevel.h"
+#include <algorithm>
+#include <math.h>
+#include <stack>
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+/// @brief One recorded draw call. Geometry lives in the display list's flat arrays.
+struct PictureOp {
+    enum Kind { kPaint, kRect, kPolygon, kPath, kMesh, kQuad };
+
+    Kind kind;
+    int matrix; // index into matrices
+    int paint;  // index into paints
+    int data;   // index into rects / points / paths / meshes, depending on kind
+    int count;  // number of polygon points
+    int clip;   // index into clips, or -1 if unclipped
+    GIRect bounds; // device bounds, clipped to the recording size and the clip
+};
+
+/// @brief One clipRect / clipPath call, applied on top of its parent (-1 for none). The
+/// geometry is stored already transformed to the recording's device space.
+struct PictureClip {
+    int parent;
+    int path;      // index into paths, or -1 for a rect clip
+    GRect rect;
+    bool antiAlias;
+};
+
+/// @brief A recorded mesh or quad; Offsets are -1 for absent colors / texs.
+struct PictureMesh {
+    int verts, colors, texs, indices;
+    int count; // number of triangles, or the level of a quad
+};
+
+/// @brief A run of adjacent ops that share a paint, CTM and clip and do not touch each other's
+/// pixels, merged into one path when the picture is made, so the path keeps its generation ID
+/// (and its cached edges) from one playback to the next.
+struct PictureBatch {
+    int begin, end; // the ops [begin, end)
+    GPath path;
+};
+
+/// @brief The display list shared by the recorder and the picture it produces.
+struct PictureData {
+    vector<PictureOp> ops;
+    vector<GMatrix> matrices;
+    vector<GPaint> paints;
+    vector<GRect> rects;
+    vector<GPoint> points;
+    vector<GColor> colors;
+    vector<int> indices;
+    vector<GPath> paths;
+    vector<PictureMesh> meshes;
+    vector<PictureClip> clips;
+    vector<PictureBatch> batches; // in op order; Built by the picture, not recorded
+    GIRect bounds = GIRect::LTRB(0, 0, 0, 0);
+    GIRect device = GIRect::LTRB(0, 0, 0, 0); // the recording size
+};
+
+static bool sameMatrix(const GMatrix& a, const GMatrix& b) {
+    for (int i = 0; i < 6; i ++) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+static bool samePaint(const GPaint& a, const GPaint& b) {
+    return a.getColor() == b.getColor() && a.getShader() == b.getShader() &&
+        a.getBlendMode() == b.getBlendMode() && a.isAntiAlias() == b.isAntiAlias();
+}
+
+static bool sameRect(const GRect& a, const GRect& b) {
+    return a.fLeft == b.fLeft && a.fTop == b.fTop && a.fRight == b.fRight && a.fBottom == b.fBottom;
+}
+
+static bool sameIRect(const GIRect& a, const GIRect& b) {
+    return a.fLeft == b.fLeft && a.fTop == b.fTop && a.fRight == b.fRight && a.fBottom == b.fBottom;
+}
+
+/// @brief Whether two paths have the same contours; Copies of an unchanged path share an ID.
+static bool samePath(const GPath& a, const GPath& b) {
+    if (a.getGenerationID() == b.getGenerationID()) return true;
+    if (a.countPoints() != b.countPoints()) return false;
+    GPath::Iter iterA(a), iterB(b);
+    GPoint ptsA[GPath::kMaxNextPoints], ptsB[GPath::kMaxNextPoints];
+    for (;;) {
+        GPath::Verb v = iterA.next(ptsA);
+        if (v != iterB.next(ptsB)) return false;
+        if (v == GPath::kDone) return true;
+        int n = v == GPath::kMove ? 1 : v == GPath::kLine ? 2 : v == GPath::kQuad ? 3 : 4;
+        if (!equal(ptsA, ptsA + n, ptsB)) return false;
+    }
+}
+
+static int64_t area(const GIRect& r) {
+    return (int64_t)r.width() * r.height();
+}
+
+static bool intersects(const GIRect& a, const GIRect& b) {
+    return a.fLeft < b.fRight && b.fLeft < a.fRight && a.fTop < b.fBottom && b.fTop < a.fBottom;
+}
+
+static GIRect intersect(const GIRect& a, const GIRect& b) {
+    GIRect r = GIRect::LTRB(max(a.fLeft, b.fLeft), max(a.fTop, b.fTop),
+                            min(a.fRight, b.fRight), min(a.fBottom, b.fBottom));
+    return r.isEmpty() ? GIRect::LTRB(0, 0, 0, 0) : r;
+}
+
+static GIRect join(const GIRect& a, const GIRect& b) {
+    return GIRect::LTRB(min(a.fLeft, b.fLeft), min(a.fTop, b.fTop),
+                        max(a.fRight, b.fRight), max(a.fBottom, b.fBottom));
+}
+
+/// @brief The whole pixels inside r, pinned to the device.
+static GIRect roundIn(const GRect& r, const GIRect& device) {
+    float l = max(r.fLeft, (float)device.fLeft), t = max(r.fTop, (float)device.fTop);
+    float rt = min(r.fRight, (float)device.fRight), b = min(r.fBottom, (float)device.fBottom);
+    if (!(l < rt && t < b)) return GIRect::LTRB(0, 0, 0, 0);
+    return GIRect::LTRB((int)ceilf(l), (int)ceilf(t), (int)floorf(rt), (int)floorf(b));
+}
+
+/// @brief Whether drawing with paint leaves nothing of what was under a fully covered pixel.
+static bool hidesBelow(const GPaint& paint) {
+    switch (paint.getBlendMode()) {
+        case GBlendMode::kClear:
+        case GBlendMode::kSrc:
+            return true;
+        case GBlendMode::kSrcOver:
+            return paint.getShader() ? paint.getShader()->isOpaque() : paint.getColor().a >= 1;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Which tiles of the device are known to be covered by opaque ops, for the
+ * occlusion pass. A tile only counts once a single op covers all of it.
+ */
+class TileCoverage {
+public:
+    TileCoverage(const GIRect& device)
+        : device(device), cols((device.width() + kTile - 1) / kTile),
+          rows((device.height() + kTile - 1) / kTile), covered(max(cols * rows, 0), false) {}
+
+    /// @brief Mark the tiles that lie entirely inside rect.
+    void add(const GIRect& rect) {
+        forEachTile(rect, [&](int index, const GIRect& tile) {
+            if (contains(rect, tile)) covered[index] = true;
+        });
+    }
+
+    /// @brief Bounds of the parts of rect outside the covered tiles; Empty if all of it is covered.
+    GIRect uncovered(const GIRect& rect) const {
+        GIRect result = GIRect::LTRB(0, 0, 0, 0);
+        forEachTile(rect, [&](int index, const GIRect& tile) {
+            if (covered[index]) return;
+            GIRect part = intersect(tile, rect);
+            result = result.isEmpty() ? part : join(result, part);
+        });
+        return result;
+    }
+
+private:
+    static const int kTile = 16;
+
+    GIRect device;
+    int cols, rows;
+    vector<bool> covered;
+
+    static bool contains(const GIRect& outer, const GIRect& inner) {
+        return outer.fLeft <= inner.fLeft && outer.fTop <= inner.fTop &&
+            outer.fRight >= inner.fRight && outer.fBottom >= inner.fBottom;
+    }
+
+    /// @brief Call f with the index and device-clipped rect of each tile rect touches.
+    template <typename F> void forEachTile(GIRect rect, F f) const {
+        rect = intersect(rect, device);
+        if (rect.isEmpty()) return;
+        int x0 = (rect.fLeft - device.fLeft) / kTile, x1 = (rect.fRight - 1 - device.fLeft) / kTile;
+        int y0 = (rect.fTop - device.fTop) / kTile, y1 = (rect.fBottom - 1 - device.fTop) / kTile;
+        for (int y = y0; y <= y1; y ++) {
+            for (int x = x0; x <= x1; x ++) {
+                GIRect tile = GIRect::XYWH(device.fLeft + x * kTile, device.fTop + y * kTile, kTile, kTile);
+                f(y * cols + x, intersect(tile, device));
+            }
+        }
+    }
+};
+
+/// @brief Append every contour of src to dst.
+static void appendPath(GPath& dst, const GPath& src) {
+    GPath::Iter iter(src);
+    GPoint pts[GPath::kMaxNextPoints];
+    for (GPath::Verb v = iter.next(pts); v != GPath::kDone; v = iter.next(pts)) {
+        switch (v) {
+            case GPath::kMove:  dst.moveTo(pts[0]); break;
+            case GPath::kLine:  dst.lineTo(pts[1]); break;
+            case GPath::kQuad:  dst.quadTo(pts[1], pts[2]); break;
+            case GPath::kCubic: dst.cubicTo(pts[1], pts[2], pts[3]); break;
+            default: break;
+        }
+    }
+}
+
+class Picture : public GPicture {
+public:
+    Picture(PictureData&& data) : d(batched(std::move(data))) {}
+
+    GIRect bounds() const override { return d.bounds; }
+
+    int countOps() const override { return (int)d.ops.size(); }
+
+    GIRect device() const { return d.device; }
+
+    std::shared_ptr<const GPicture> cullOccluded(GOcclusionStats* stats) const override {
+        GOcclusionStats counts;
+        PictureData culled = d;
+        culled.ops.clear();
+        TileCoverage covered(d.device);
+        // Back to front, so each op is checked against everything drawn over it
+        for (size_t i = d.ops.size(); i -- > 0;) {
+            PictureOp op = d.ops[i];
+            GIRect visible = covered.uncovered(op.bounds);
+            if (visible.isEmpty()) {
+                counts.opsDropped ++;
+                counts.pixelsSaved += area(op.bounds);
+                continue;
+            }
+            // Clipping costs the op its chance to merge with its neighbors; Only do it for a good saving
+            if (area(visible) * 4 <= area(op.bounds) * 3) {
+                GRect rect = GRect::LTRB(visible.fLeft, visible.fTop, visible.fRight, visible.fBottom);
+                culled.clips.push_back(PictureClip({op.clip, -1, rect, false}));
+                op.clip = (int)culled.clips.size() - 1;
+                counts.opsClipped ++;
+                counts.pixelsSaved += area(op.bounds) - area(visible);
+                op.bounds = visible;
+            }
+            covered.add(opaqueInterior(d.ops[i]));
+            culled.ops.push_back(op);
+        }
+        reverse(culled.ops.begin(), culled.ops.end());
+
+        culled.bounds = GIRect::LTRB(0, 0, 0, 0);
+        for (size_t i = 0; i < culled.ops.size(); i ++) {
+            culled.bounds = i == 0 ? culled.ops[i].bounds : join(culled.bounds, culled.ops[i].bounds);
+        }
+        if (stats) *stats = counts;
+        return std::shared_ptr<const GPicture>(new Picture(std::move(culled)));
+    }
+
+    /**
+     * @brief Call damage with the bounds of both ops wherever this picture and next differ at
+     * the same index, and with the bounds of the ops past the end of the shorter one.
+     */
+    template <typename F> void forEachDamage(const Picture& next, F damage) const {
+        const vector<PictureOp>& ops = d.ops;
+        const vector<PictureOp>& nextOps = next.d.ops;
+        size_t common = min(ops.size(), nextOps.size());
+        for (size_t i = 0; i < common; i ++) {
+            if (!sameOp(ops[i], next, nextOps[i])) {
+                damage(ops[i].bounds);
+                damage(nextOps[i].bounds);
+            }
+        }
+        for (size_t i = common; i < ops.size(); i ++) damage(ops[i].bounds);
+        for (size_t i = common; i < nextOps.size(); i ++) damage(nextOps[i].bounds);
+    }
+
+    void playback(GCanvas* canvas, const GIRect& target) const override {
+        canvas->save();
+        int currMatrix = -1;
+        int currClip = -1;
+        size_t batch = 0;
+        size_t i = 0;
+        while (i < d.ops.size()) {
+            const PictureOp& op = d.ops[i];
+            if (!intersects(op.bounds, target)) {
+                i ++;
+                continue;
+            }
+            if (op.matrix != currMatrix || op.clip != currClip) {
+                canvas->restore();
+                canvas->save();
+                applyClip(canvas, op.clip);
+                canvas->concat(d.matrices[op.matrix]);
+                currMatrix = op.matrix;
+                currClip = op.clip;
+            }
+
+            // A batch is drawn as its merged path only when all of it is in target, since an op
+            // outside target must not draw; Otherwise its ops draw one by one, to the same pixels
+            while (batch < d.batches.size() && d.batches[batch].begin < (int)i) batch ++;
+            size_t end = i + 1;
+            if (batch < d.batches.size() && d.batches[batch].begin == (int)i) {
+                const PictureBatch& b = d.batches[batch];
+                bool inside = true;
+                for (int j = b.begin; j < b.end; j ++) {
+                    inside &= intersects(d.ops[j].bounds, target);
+                }
+                if (inside) {
+                    canvas->drawPath(b.path, d.paints[op.paint]);
+                    end = b.end;
+                }
+            }
+            if (end == i + 1) {
+                drawOp(canvas, op);
+            }
+            i = end;
+        }
+        canvas->restore();
+    }
+
+private:
+    const PictureData d;
+
+    /// @brief Apply a clip and its parents, oldest first, under the playback CTM.
+    void applyClip(GCanvas* canvas, int clip) const {
+        if (clip < 0) return;
+        const PictureClip& c = d.clips[clip];
+        applyClip(canvas, c.parent);
+        if (c.path < 0) {
+            canvas->clipRect(c.rect);
+        } else {
+            canvas->clipPath(d.paths[c.path], c.antiAlias);
+        }
+    }
+
+    /// @brief The device pixels op is sure to cover opaquely; Empty unless it is a rect or paint
+    /// fill, with a paint that hides what is below, under a scale / translate CTM and rect clips.
+    GIRect opaqueInterior(const PictureOp& op) const {
+        const GIRect none = GIRect::LTRB(0, 0, 0, 0);
+        if (!hidesBelow(d.paints[op.paint])) return none;
+        GIRect interior = op.bounds;
+        if (op.kind == PictureOp::kRect) {
+            const GMatrix& m = d.matrices[op.matrix];
+            if (m[1] != 0 || m[3] != 0) return none;
+            const GRect& r = d.rects[op.data];
+            float x0 = m[0] * r.fLeft + m[2], x1 = m[0] * r.fRight + m[2];
+            float y0 = m[4] * r.fTop + m[5], y1 = m[4] * r.fBottom + m[5];
+            GRect device = GRect::LTRB(min(x0, x1), min(y0, y1), max(x0, x1), max(y0, y1));
+            interior = intersect(interior, roundIn(device, d.device));
+        } else if (op.kind != PictureOp::kPaint) {
+            return none;
+        }
+        for (int c = op.clip; c >= 0; c = d.clips[c].parent) {
+            if (d.clips[c].path >= 0) return none;
+            interior = intersect(interior, roundIn(d.clips[c].rect, d.device));
+        }
+        return interior;
+    }
+
+    /// @brief Whether op draws the same pixels as other's op b, as far as can be told cheaply.
+    bool sameOp(const PictureOp& a, const Picture& other, const PictureOp& b) const {
+        const PictureData& o = other.d;
+        if (a.kind != b.kind || a.count != b.count || !sameIRect(a.bounds, b.bounds) ||
+            !sameMatrix(d.matrices[a.matrix], o.matrices[b.matrix]) ||
+            !samePaint(d.paints[a.paint], o.paints[b.paint]) || !sameClip(a.clip, other, b.clip)) {
+            return false;
+        }
+        switch (a.kind) {
+            case PictureOp::kPaint:
+                return true;
+            case PictureOp::kRect:
+                return sameRect(d.rects[a.data], o.rects[b.data]);
+            case PictureOp::kPolygon:
+                return equal(&d.points[a.data], &d.points[a.data] + a.count, &o.points[b.data]);
+            case PictureOp::kPath:
+                return samePath(d.paths[a.data], o.paths[b.data]);
+            case PictureOp::kMesh:
+            case PictureOp::kQuad: {
+                const PictureMesh& ma = d.meshes[a.data];
+                const PictureMesh& mb = o.meshes[b.data];
+                if (ma.count != mb.count || (ma.colors < 0) != (mb.colors < 0) || (ma.texs < 0) != (mb.texs < 0)) {
+                    return false;
+                }
+                int vertCount = 4;
+                if (a.kind == PictureOp::kMesh) {
+                    const int* indices = &d.indices[ma.indices];
+                    if (!equal(indices, indices + ma.count * 3, &o.indices[mb.indices])) return false;
+                    vertCount = *max_element(indices, indices + ma.count * 3) + 1;
+                }
+                return equal(&d.points[ma.verts], &d.points[ma.verts] + vertCount, &o.points[mb.verts]) &&
+                    (ma.colors < 0 || equal(&d.colors[ma.colors], &d.colors[ma.colors] + vertCount, &o.colors[mb.colors])) &&
+                    (ma.texs < 0 || equal(&d.points[ma.texs], &d.points[ma.texs] + vertCount, &o.points[mb.texs]));
+            }
+        }
+        return false;
+    }
+
+    bool sameClip(int a, const Picture& other, int b) const {
+        if (a < 0 || b < 0) return a == b;
+        const PictureClip& ca = d.clips[a];
+        const PictureClip& cb = other.d.clips[b];
+        if ((ca.path < 0) != (cb.path < 0) || ca.antiAlias != cb.antiAlias) return false;
+        if (ca.path < 0 ? !sameRect(ca.rect, cb.rect) : !samePath(d.paths[ca.path], other.d.paths[cb.path])) {
+            return false;
+        }
+        return sameClip(ca.parent, other, cb.parent);
+    }
+
+    /// @brief Ops that fill a single area with one paint, and so can be combined into one path.
+    static bool isMergeable(const PictureOp& op) {
+        return op.kind == PictureOp::kRect || op.kind == PictureOp::kPolygon ||
+            op.kind == PictureOp::kPath;
+    }
+
+    /// @brief data, with each run of two or more ops that can share a single drawPath merged into a batch.
+    static PictureData batched(PictureData&& data) {
+        data.batches.clear();
+        const vector<PictureOp>& ops = data.ops;
+        size_t i = 0;
+        while (i < ops.size()) {
+            const PictureOp& op = ops[i];
+            size_t end = i + 1;
+            if (isMergeable(op)) {
+                GIRect bounds = op.bounds;
+                while (end < ops.size()) {
+                    const PictureOp& next = ops[end];
+                    if (!isMergeable(next) || next.matrix != op.matrix || next.paint != op.paint ||
+                        next.clip != op.clip || intersects(next.bounds, bounds)) {
+                        break;
+                    }
+                    bounds = join(bounds, next.bounds);
+                    end ++;
+                }
+            }
+            if (end > i + 1) {
+                data.batches.push_back(PictureBatch());
+                PictureBatch& batch = data.batches.back();
+                batch.begin = (int)i;
+                batch.end = (int)end;
+                for (size_t j = i; j < end; j ++) {
+                    addToPath(data, batch.path, ops[j]);
+                }
+            }
+            i = end;
+        }
+        return std::move(data);
+    }
+
+    static void addToPath(const PictureData& data, GPath& path, const PictureOp& op) {
+        switch (op.kind) {
+            case PictureOp::kRect: path.addRect(data.rects[op.data]); break;
+            case PictureOp::kPolygon: path.addPolygon(&data.points[op.data], op.count); break;
+            case PictureOp::kPath: appendPath(path, data.paths[op.data]); break;
+            default: break;
+        }
+    }
+
+    void drawOp(GCanvas* canvas, const PictureOp& op) const {
+        const GPaint& paint = d.paints[op.paint];
+        switch (op.kind) {
+            case PictureOp::kPaint:
+                canvas->drawPaint(paint);
+                break;
+            case PictureOp::kRect:
+                canvas->drawRect(d.rects[op.data], paint);
+                break;
+            case PictureOp::kPolygon:
+                canvas->drawConvexPolygon(&d.points[op.data], op.count, paint);
+                break;
+            case PictureOp::kPath:
+                canvas->drawPath(d.paths[op.data], paint);
+                break;
+            case PictureOp::kMesh: {
+                const PictureMesh& mesh = d.meshes[op.data];
+                canvas->drawMesh(&d.points[mesh.verts],
+                                 mesh.colors < 0 ? nullptr : &d.colors[mesh.colors],
+                                 mesh.texs < 0 ? nullptr : &d.points[mesh.texs],
+                                 mesh.count, &d.indices[mesh.indices], paint);
+                break;
+            }
+            case PictureOp::kQuad: {
+                const PictureMesh& quad = d.meshes[op.data];
+                canvas->drawQuad(&d.points[quad.verts],
+                                 quad.colors < 0 ? nullptr : &d.colors[quad.colors],
+                                 quad.texs < 0 ? nullptr : &d.points[quad.texs],
+                                 quad.count, paint);
+                break;
+            }
+        }
+    }
+};
+
+class RecordingCanvas : public GRecordingCanvas {
+public:
+    RecordingCanvas(GISize size) : device(GIRect::WH(size.width(), size.height())) {
+        matrixStack.push(GMatrix());
+        clipStack.push(ClipState({-1, device}));
+        d.device = device;
+    }
+
+    void save() override {
+        matrixStack.push(matrixStack.top());
+        clipStack.push(clipStack.top());
+    }
+
+    void restore() override {
+        matrixStack.pop();
+        clipStack.pop();
+    }
+
+    void clipRect(const GRect& rect) override {
+        const GMatrix& ctm = matrixStack.top();
+        GPoint pts[4] = {
+            {rect.left(), rect.top()}, {rect.right(), rect.top()},
+            {rect.right(), rect.bottom()}, {rect.left(), rect.bottom()}
+        };
+        if (ctm[1] != 0 || ctm[3] != 0) {
+            GPath path;
+            path.addRect(rect);
+            clipPath(path, false);
+            return;
+        }
+        ctm.mapPoints(pts, 4);
+        GRect deviceRect = GRect::LTRB(min(pts[0].x(), pts[2].x()), min(pts[0].y(), pts[2].y()),
+                                       max(pts[0].x(), pts[2].x()), max(pts[0].y(), pts[2].y()));
+        addClip(-1, deviceRect, false, mapBounds(pts, 4));
+    }
+
+    void clipPath(const GPath& path, bool antiAlias) override {
+        GPath devicePath = path;
+        devicePath.transform(matrixStack.top());
+        GIRect bounds = GIRect::LTRB(0, 0, 0, 0);
+        if (devicePath.countPoints() > 0) {
+            GRect r = devicePath.bounds();
+            GPoint corners[2] = {{r.left(), r.top()}, {r.right(), r.bottom()}};
+            bounds = mapBoundsUnder(GMatrix(), corners, 2);
+        }
+        d.paths.push_back(devicePath);
+        addClip((int)d.paths.size() - 1, GRect::LTRB(0, 0, 0, 0), antiAlias, bounds);
+    }
+
+    void concat(const GMatrix& matrix) override {
+        GMatrix newTop = GMatrix::Concat(matrixStack.top(), matrix);
+        matrixStack.pop();
+        matrixStack.push(newTop);
+    }
+
+    void drawPaint(const GPaint& paint) override {
+        addOp(PictureOp::kPaint, device, paint, 0, 0);
+    }
+
+    void drawRect(const GRect& rect, const GPaint& paint) override {
+        GPoint pts[4] = {
+            {rect.left(), rect.top()}, {rect.right(), rect.top()},
+            {rect.right(), rect.bottom()}, {rect.left(), rect.bottom()}
+        };
+        if (addOp(PictureOp::kRect, mapBounds(pts, 4), paint, (int)d.rects.size(), 0)) {
+            d.rects.push_back(rect);
+        }
+    }
+
+    void drawConvexPolygon(const GPoint points[], int count, const GPaint& paint) override {
+        if (count < 3) return;
+        if (addOp(PictureOp::kPolygon, mapBounds(points, count), paint, (int)d.points.size(), count)) {
+            d.points.insert(d.points.end(), points, points + count);
+        }
+    }
+
+    void drawPath(const GPath& path, const GPaint& paint) override {
+        vector<GPoint> pts;
+        GPath::Iter iter(path);
+        GPoint next[GPath::kMaxNextPoints];
+        for (GPath::Verb v = iter.next(next); v != GPath::kDone; v = iter.next(next)) {
+            // Every verb but kMove repeats the previous end point in next[0]
+            int n = v == GPath::kMove ? 1 : v == GPath::kLine ? 2 : v == GPath::kQuad ? 3 : 4;
+            pts.insert(pts.end(), next + (v == GPath::kMove ? 0 : 1), next + n);
+        }
+        if (pts.empty()) return;
+        if (addOp(PictureOp::kPath, mapBounds(pts.data(), (int)pts.size()), paint,
+                  (int)d.paths.size(), 0)) {
+            d.paths.push_back(path);
+        }
+    }
+
+    void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[],
+                  int count, const int indices[], const GPaint& paint) override {
+        if (count <= 0) return;
+        int vertCount = 0;
+        for (int i = 0; i < count * 3; i ++) {
+            vertCount = max(vertCount, indices[i] + 1);
+        }
+        if (!addOp(PictureOp::kMesh, mapBounds(verts, vertCount), paint, (int)d.meshes.size(), 0)) {
+            return;
+        }
+        PictureMesh mesh;
+        mesh.verts = addPoints(verts, vertCount);
+        mesh.colors = addColors(colors, vertCount);
+        mesh.texs = addPoints(texs, vertCount);
+        mesh.indices = (int)d.indices.size();
+        mesh.count = count;
+        d.indices.insert(d.indices.end(), indices, indices + count * 3);
+        d.meshes.push_back(mesh);
+    }
+
+    void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+                  int level, const GPaint& paint) override {
+        if (!addOp(PictureOp::kQuad, mapBounds(verts, 4), paint, (int)d.meshes.size(), 0)) {
+            return;
+        }
+        PictureMesh quad;
+        quad.verts = addPoints(verts, 4);
+        quad.colors = addColors(colors, 4);
+        quad.texs = addPoints(texs, 4);
+        quad.indices = -1;
+        quad.count = level;
+        d.meshes.push_back(quad);
+    }
+
+    /// @brief The level is picked under the recording CTM, and played back as a plain drawQuad.
+    void drawQuadAuto(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+                      float maxError, const GPaint& paint) override {
+        GPoint deviceVerts[4];
+        matrixStack.top().mapPoints(deviceVerts, verts, 4);
+        drawQuad(verts, colors, texs, GComputeQuadLevel(deviceVerts, colors, texs, maxError), paint);
+    }
+
+    std::shared_ptr<const GPicture> finishRecording() override {
+        std::shared_ptr<const GPicture> picture(new Picture(std::move(d)));
+        d = PictureData();
+        d.device = device;
+        return picture;
+    }
+
+private:
+    /// @brief The clip at one save level: its newest PictureClip, and the device bounds it allows.
+    struct ClipState {
+        int clip;
+        GIRect bounds;
+    };
+
+    GIRect device;
+    stack<GMatrix> matrixStack;
+    stack<ClipState> clipStack;
+    PictureData d;
+
+    void addClip(int path, const GRect& rect, bool antiAlias, const GIRect& bounds) {
+        ClipState& state = clipStack.top();
+        d.clips.push_back(PictureClip({state.clip, path, rect, antiAlias}));
+        state.clip = (int)d.clips.size() - 1;
+        state.bounds = intersect(state.bounds, bounds);
+    }
+
+    /// @brief Device bounds of the points under the CTM, rounded out to whole pixels.
+    GIRect mapBounds(const GPoint points[], int count) const {
+        return mapBoundsUnder(matrixStack.top(), points, count);
+    }
+
+    GIRect mapBoundsUnder(const GMatrix& ctm, const GPoint points[], int count) const {
+        GRect r = GRect::LTRB(INFINITY, INFINITY, -INFINITY, -INFINITY);
+        for (int i = 0; i < count; i ++) {
+            GPoint p = ctm * points[i];
+            r.fLeft = min(r.fLeft, p.x());
+            r.fTop = min(r.fTop, p.y());
+            r.fRight = max(r.fRight, p.x());
+            r.fBottom = max(r.fBottom, p.y());
+        }
+        if (!(r.fLeft <= r.fRight && r.fTop <= r.fBottom)) return GIRect::LTRB(0, 0, 0, 0);
+        // Pin before rounding so huge coordinates cannot overflow the integer rect
+        r.fLeft = max(r.fLeft, (float)device.fLeft);
+        r.fTop = max(r.fTop, (float)device.fTop);
+        r.fRight = min(r.fRight, (float)device.fRight);
+        r.fBottom = min(r.fBottom, (float)device.fBottom);
+        return r.roundOut();
+    }
+
+    /**
+     * @brief Append an op drawn with the current CTM, sharing the previous matrix and paint
+     * entries when they are unchanged.
+     * @return False if the op lies outside the device or the clip, and was dropped.
+     */
+    bool addOp(PictureOp::Kind kind, const GIRect& unclipped, const GPaint& paint, int data, int count) {
+        const ClipState& clip = clipStack.top();
+        GIRect bounds = intersect(unclipped, clip.bounds);
+        if (bounds.isEmpty()) return false;
+        const GMatrix& ctm = matrixStack.top();
+        if (d.matrices.empty() || !sameMatrix(d.matrices.back(), ctm)) {
+            d.matrices.push_back(ctm);
+        }
+        if (d.paints.empty() || !samePaint(d.paints.back(), paint)) {
+            d.paints.push_back(paint);
+        }
+        PictureOp op = {kind, (int)d.matrices.size() - 1, (int)d.paints.size() - 1, data, count, clip.clip, bounds};
+        d.ops.push_back(op);
+        d.bounds = d.ops.size() == 1 ? bounds : join(d.bounds, bounds);
+        return true;
+    }
+
+    int addPoints(const GPoint points[], int count) {
+        if (!points) return -1;
+        int offset = (int)d.points.size();
+        d.points.insert(d.points.end(), points, points + count);
+        return offset;
+    }
+
+    int addColors(const GColor colors[], int count) {
+        if (!colors) return -1;
+        int offset = (int)d.colors.size();
+        d.colors.insert(d.colors.end(), colors, colors + count);
+        return offset;
+    }
+};
+
+std::unique_ptr<GRecordingCanvas> GCreateRecordingCanvas(GISize size) {
+    return std::unique_ptr<GRecordingCanvas>(new RecordingCanvas(size));
+}
+
+const std::vector<GIRect>& GDamageTracker::draw(std::shared_ptr<const GPicture> frame, GCanvas* canvas) {
+    // Every GPicture is a Picture, made by a recording canvas
+    const Picture& next = static_cast<const Picture&>(*frame);
+    const Picture* previous = static_cast<const Picture*>(fPrevious.get());
+    fDirty.clear();
+    if (previous && sameIRect(previous->device(), next.device())) {
+        previous->forEachDamage(next, [this](const GIRect& bounds) { this->addDirty(bounds); });
+    } else {
+        addDirty(next.device());
+    }
+
+    for (const GIRect& r : fDirty) {
+        canvas->save();
+        canvas->clipRect(GRect::LTRB(r.fLeft, r.fTop, r.fRight, r.fBottom));
+        frame->playback(canvas, r);
+        canvas->restore();
+    }
+    fPrevious = std::move(frame);
+    return fDirty;
+}
+
+int64_t GDamageTracker::pixelsRedrawn() const {
+    int64_t pixels = 0;
+    for (const GIRect& r : fDirty) {
+        pixels += area(r);
+    }
+    return pixels;
+}
+
+void GDamageTracker::addDirty(GIRect rect) {
+    if (rect.isEmpty()) return;
+    // Absorb the rects this one overlaps, so no pixel is redrawn twice
+    size_t i = 0;
+    while (i < fDirty.size()) {
+        if (intersects(fDirty[i], rect)) {
+            rect = join(rect, fDirty[i]);
+            fDirty.erase(fDirty.begin() + i);
+            i = 0; // the grown rect may now reach rects already passed
+        } else {
+            i ++;
+        }
+    }
+    fDirty.push_back(rect);
+    if ((int)fDirty.size() <= max(fMaxRects, 1)) return;
+
+    // Too many: merge the two whose union adds the fewest pixels
+    size_t bestA = 0, bestB = 1;
+    int64_t bestCost = INT64_MAX;
+    for (size_t a = 0; a < fDirty.size(); a ++) {
+        for (size_t b = a + 1; b < fDirty.size(); b ++) {
+            int64_t cost = area(join(fDirty[a], fDirty[b])) - area(fDirty[a]) - area(fDirty[b]);
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestA = a;
+                bestB = b;
+            }
+        }
+    }
+    GIRect merged = join(fDirty[bestA], fDirty[bestB]);
+    fDirty.erase(fDirty.begin() + bestB);
+    fDirty.erase(fDirty.begin() + bestA);
+    addDirty(merged);
+}
@@ -0,0 +1,389 @@
+// Comparisons that may raise FP exceptions otherwise keep the stages' selects from
+// becoming vector blends; Nothing here reads the exception flags. Set before the
+// includes, so what they define inlines into the stages.
+#pragma GCC optimize("no-trapping-math")
+
+#include "./GRasterPipeline.h"
+#include "./GBlenders.h"
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+namespace {
+
+enum { L = GRasterPipeline::kLanes };
+
+// Bitmap coordinates in 32.32 fixed point. Floats convert exactly, down to 2^-32, and
+// stepping along a span adds exactly, so each sample lands where the real numbers put it;
+// Stepping in float rounds, and may cross a texel edge the real coordinate does not.
+typedef int64_t Fixed;
+const Fixed kFixedOne = (Fixed)1 << 32;
+
+/// @brief The state the stages pass along: one block of pixels of one span.
+struct Block {
+    int x, y;            // the span's first pixel
+    int j;               // the block's first pixel, from the start of the span
+    int n;               // pixels in the block; The lanes past n hold junk that is never stored
+    GPixel* dst;
+    const uint8_t* coverage;
+
+    // highp
+    float fx[L], fy[L];
+    float r[L], g[L], b[L], a[L];
+
+    // lowp
+    GPixel src[L];
+
+    // The bitmap stages' samples, set up at the span's first block: the block's first one,
+    // wrapped into its period, and the step to the next, in Fixed, unless the span is too
+    // far out for it; And the row they read, if they all read one
+    bool fixed;
+    Fixed u, v, du, dv;
+    const GPixel* row;
+};
+
+typedef void (*StageFn)(Block& k, const void* ctx);
+
+/// @brief floorf, for values that fit an int; Unlike floorf, it vectorizes without SSE4.1.
+static inline float floorLane(float v) {
+    float t = (float)(int)v;
+    return t - (float)(t > v);
+}
+
+// highp stages
+
+void seed(Block& k, const void* ctx) {
+    // Step from the span's first pixel, as the scalar shaders do, so both sample the same texels
+    const GMatrix& m = *(const GMatrix*)ctx;
+    GPoint start = m * GPoint{k.x + 0.5f, k.y + 0.5f};
+    float dx = m[0], dy = m[3];
+    for (int i = 0; i < L; i ++) {
+        float j = (float)(k.j + i);
+        k.fx[i] = start.fX + dx * j;
+        k.fy[i] = start.fY + dy * j;
+    }
+}
+
+void gradientClamp(Block& k, const void*) {
+    for (int i = 0; i < L; i ++) {
+        k.fx[i] = std::min(std::max(k.fx[i], 0.0f), 1.0f);
+    }
+}
+
+void gradientRepeat(Block& k, const void*) {
+    for (int i = 0; i < L; i ++) {
+        k.fx[i] = k.fx[i] - floorLane(k.fx[i]);
+    }
+}
+
+void gradientMirror(Block& k, const void*) {
+    for (int i = 0; i < L; i ++) {
+        float half = k.fx[i] / 2;
+        float t = half - floorLane(half);
+        k.fx[i] = (t > 0.5f ? 1 - t : t) * 2;
+    }
+}
+
+void gradient(Block& k, const void* ctx) {
+    const GPipelineGradient& grad = *(const GPipelineGradient*)ctx;
+    int start[L];
+    float w[L];
+    for (int i = 0; i < L; i ++) {
+        float index = k.fx[i] * (grad.count - 1);
+        start[i] = (int)floorLane(index);
+        w[i] = (start[i] + 1) - index;
+    }
+    // Look the stops up, then mix them in a loop that vectorizes
+    float c0[4][L], c1[4][L];
+    for (int i = 0; i < L; i ++) {
+        const GColor& lo = grad.colors[start[i]];
+        const GColor& hi = grad.colors[start[i] + 1];
+        c0[0][i] = lo.r; c0[1][i] = lo.g; c0[2][i] = lo.b; c0[3][i] = lo.a;
+        c1[0][i] = hi.r; c1[1][i] = hi.g; c1[2][i] = hi.b; c1[3][i] = hi.a;
+    }
+    for (int i = 0; i < L; i ++) {
+        float ew = 1 - w[i];
+        k.r[i] = c0[0][i] * w[i] + c1[0][i] * ew;
+        k.g[i] = c0[1][i] * w[i] + c1[1][i] * ew;
+        k.b[i] = c0[2][i] * w[i] + c1[2][i] * ew;
+        k.a[i] = c0[3][i] * w[i] + c1[3][i] * ew;
+    }
+}
+
+void premul(Block& k, const void*) {
+    // Colors are never negative, so truncating x + 0.5 rounds like GRoundToInt
+    for (int i = 0; i < L; i ++) {
+        unsigned a = (int)(k.a[i] * 255 + 0.5f);
+        unsigned r = Blenders::div255((int)(k.r[i] * 255 + 0.5f) * a);
+        unsigned g = Blenders::div255((int)(k.g[i] * 255 + 0.5f) * a);
+        unsigned b = Blenders::div255((int)(k.b[i] * 255 + 0.5f) * a);
+        k.src[i] = a << 24 | r << 16 | g << 8 | b;
+    }
+}
+
+// lowp stages
+
+static inline float repeat(float v, float size) {
+    v = v / size;
+    v = (v - floorLane(v)) * size;
+    return std::min(v, size - 1);
+}
+
+static inline float mirror(float v, float size) {
+    v = v / (2 * size);
+    v = v - floorLane(v);
+    float reflected = (0.5f - (v - 0.5f)) * 2 * size;
+    v = v <= 0.5f ? v * 2 * size : reflected;
+    return std::min(v, size - 1);
+}
+
+static inline float tileFloat(GShader::TileMode mode, float v, float size) {
+    switch (mode) {
+        case GShader::kClamp:  return std::min(std::max(v, 0.0f), size - 1);
+        case GShader::kRepeat: return repeat(v, size);
+        case GShader::kMirror: return mirror(v, size);
+    }
+    return v;
+}
+
+/// @brief Sample in float, for the spans too far out for Fixed.
+template <GShader::TileMode Mode> void bitmapFloat(Block& k, const GPipelineBitmap& bm) {
+    seed(k, bm.inverse);
+    float width = (float)bm.width, height = (float)bm.height;
+    for (int i = 0; i < L; i ++) {
+        int x = (int)tileFloat(Mode, k.fx[i], width);
+        int y = (int)tileFloat(Mode, k.fy[i], height);
+        k.src[i] = bm.pixels[y * bm.rowPixels + x];
+    }
+}
+
+static inline Fixed toFixed(float v) {
+    return (Fixed)(v * 4294967296.0f);
+}
+
+/// @brief Whether a span's samples fit Fixed: Its coordinates and their texels stay far
+/// from 64 and 32 bits, however wide the span.
+static inline bool fitsFixed(float start, float step) {
+    return std::fabs(start) < (1 << 24) && std::fabs(step) < (1 << 8);
+}
+
+static inline Fixed floorMod(Fixed v, Fixed period) {
+    Fixed r = v % period;
+    return r < 0 ? r + period : r;
+}
+
+/// @brief The texels a coordinate repeats or mirrors over, in Fixed; 0 for clamp.
+static inline Fixed period(GShader::TileMode mode, int size) {
+    return mode == GShader::kClamp ? 0 : (Fixed)size << (mode == GShader::kMirror ? 33 : 32);
+}
+
+/// @brief u + step, wrapped into [0, period) if there is one.
+static inline Fixed advance(Fixed u, Fixed step, Fixed period) {
+    u += step;
+    return period && (u < 0 || u >= period) ? floorMod(u, period) : u;
+}
+
+/// @brief The texels of the samples u, u + du, ..., and whether each sample is on a texel edge.
+static inline void texels(Fixed u, Fixed du, int texel[], int onEdge[]) {
+    for (int i = 0; i < L; i ++) {
+        texel[i] = (int)(u >> 32);
+        onEdge[i] = (uint32_t)u == 0;
+        u += du;
+    }
+}
+
+/// @brief Wrap texels into [0, period); The first one already is.
+static inline void wrap(int texel[], Fixed du, int period) {
+    if ((period & (period - 1)) == 0) {
+        for (int i = 0; i < L; i ++) {
+            texel[i] &= period - 1;
+        }
+    } else if (std::abs(du) * L < (Fixed)period << 32) {
+        // The lanes spread over less than a period, so each is at most a period out
+        for (int i = 0; i < L; i ++) {
+            int t = texel[i];
+            t += t < 0 ? period : 0;
+            t -= t >= period ? period : 0;
+            texel[i] = t;
+        }
+    } else {
+        for (int i = 0; i < L; i ++) {
+            int t = texel[i] % period;
+            texel[i] = t < 0 ? t + period : t;
+        }
+    }
+}
+
+/// @brief Tile the texels of one axis, of size texels, like the scalar shader.
+template <GShader::TileMode Mode> void tile(int texel[], const int onEdge[], Fixed du, int size);
+
+template <> void tile<GShader::kClamp>(int texel[], const int[], Fixed, int size) {
+    for (int i = 0; i < L; i ++) {
+        texel[i] = std::min(std::max(texel[i], 0), size - 1);
+    }
+}
+
+template <> void tile<GShader::kRepeat>(int texel[], const int[], Fixed du, int size) {
+    wrap(texel, du, size);
+}
+
+template <> void tile<GShader::kMirror>(int texel[], const int onEdge[], Fixed du, int size) {
+    // The scalar shader reflects the coordinates r in [size, 2 size) to 2 size - r and
+    // truncates, so those on a texel edge land a texel further out than the rest
+    wrap(texel, du, 2 * size);
+    for (int i = 0; i < L; i ++) {
+        int t = texel[i];
+        int back = std::min(2 * size - 1 - t + onEdge[i], size - 1);
+        texel[i] = t < size ? t : back;
+    }
+}
+
+/// @brief Sample one row of the bitmap, at the texels u, u + du, ... along it.
+template <GShader::TileMode Mode> void sampleRow(Block& k, const GPixel* row, Fixed u, Fixed du, int width) {
+    int x[L], onEdge[L];
+    texels(u, du, x, onEdge);
+    if (du == kFixedOne && Mode != GShader::kMirror) {
+        // Unscaled, the texels follow one another: copy them
+        if (Mode == GShader::kClamp) {
+            // Lanes left of the bitmap read its first column, and lanes right of it its last
+            int a = std::min(std::max(-x[0], 0), (int)L);
+            int b = std::min(std::max(width - x[0], a), (int)L);
+            std::fill(k.src, k.src + a, row[0]);
+            if (b > a) {
+                memcpy(k.src + a, row + x[0] + a, (b - a) * sizeof(GPixel));
+            }
+            std::fill(k.src + b, k.src + L, row[width - 1]);
+        } else {
+            for (int i = 0, start = x[0]; i < L; start = 0) {
+                int n = std::min((int)L - i, width - start);
+                memcpy(k.src + i, row + start, n * sizeof(GPixel));
+                i += n;
+            }
+        }
+        return;
+    }
+    tile<Mode>(x, onEdge, du, width);
+    for (int i = 0; i < L; i ++) {
+        k.src[i] = row[x[i]];
+    }
+}
+
+template <GShader::TileMode Mode> void bitmap(Block& k, const void* ctx) {
+    const GPipelineBitmap& bm = *(const GPipelineBitmap*)ctx;
+    Fixed periodX = period(Mode, bm.width), periodY = period(Mode, bm.height);
+    if (k.j == 0) {
+        const GMatrix& m = *bm.inverse;
+        GPoint start = m * GPoint{k.x + 0.5f, k.y + 0.5f};
+        k.fixed = fitsFixed(start.fX, m[0]) && fitsFixed(start.fY, m[3]);
+        if (!k.fixed) {
+            bitmapFloat<Mode>(k, bm);
+            return;
+        }
+        k.du = toFixed(m[0]);
+        k.dv = toFixed(m[3]);
+        k.u = advance(toFixed(start.fX), 0, periodX);
+        k.v = advance(toFixed(start.fY), 0, periodY);
+        if (k.dv == 0) {
+            // Not rotated or skewed: the whole span reads one row
+            int y[L], onEdge[L];
+            texels(k.v, 0, y, onEdge);
+            tile<Mode>(y, onEdge, 0, bm.height);
+            k.row = bm.pixels + y[0] * bm.rowPixels;
+        }
+    }
+    if (!k.fixed) {
+        bitmapFloat<Mode>(k, bm);
+        return;
+    }
+    if (k.dv == 0) {
+        sampleRow<Mode>(k, k.row, k.u, k.du, bm.width);
+    } else {
+        int x[L], y[L], xOnEdge[L], yOnEdge[L];
+        texels(k.u, k.du, x, xOnEdge);
+        texels(k.v, k.dv, y, yOnEdge);
+        tile<Mode>(x, xOnEdge, k.du, bm.width);
+        tile<Mode>(y, yOnEdge, k.dv, bm.height);
+        for (int i = 0; i < L; i ++) {
+            k.src[i] = bm.pixels[y[i] * bm.rowPixels + x[i]];
+        }
+        k.v = advance(k.v, k.dv * L, periodY);
+    }
+    k.u = advance(k.u, k.du * L, periodX);
+}
+
+void constant(Block& k, const void* ctx) {
+    std::fill(k.src, k.src + L, *(const GPixel*)ctx);
+}
+
+void shadeRow(Block& k, const void* ctx) {
+    ((GShader*)ctx)->shadeRow(k.x + k.j, k.y, k.n, k.src);
+}
+
+void skip(Block&, const void*) {}
+
+template <GBlendMode Mode> void blend(Block& k, const void*) {
+    if (k.coverage) {
+        GBlendRow<Mode, true, true>(k.dst, k.src, k.coverage, k.n);
+    } else {
+        GBlendRow<Mode, true, false>(k.dst, k.src, nullptr, k.n);
+    }
+}
+
+// In the order of GRasterPipeline::Stage
+const StageFn gStages[GRasterPipeline::kStageCount] = {
+    seed, gradientClamp, gradientRepeat, gradientMirror, gradient, premul,
+    bitmap<GShader::kClamp>, bitmap<GShader::kRepeat>, bitmap<GShader::kMirror>,
+    constant, shadeRow,
+};
+
+// In the order of GBlendMode; kDst changes nothing, not even where there is coverage
+const StageFn gBlendStages[] = {
+    blend<GBlendMode::kClear>, blend<GBlendMode::kSrc>, skip,
+    blend<GBlendMode::kSrcOver>, blend<GBlendMode::kDstOver>, blend<GBlendMode::kSrcIn>,
+    blend<GBlendMode::kDstIn>, blend<GBlendMode::kSrcOut>, blend<GBlendMode::kDstOut>,
+    blend<GBlendMode::kSrcATop>, blend<GBlendMode::kDstATop>, blend<GBlendMode::kXor>,
+};
+
+} // namespace
+
+void GRasterPipeline::run(int x, int y, int count, GPixel* dst, const uint8_t* coverage) const {
+    Block k;
+    k.x = x;
+    k.y = y;
+    for (int j = 0; j < count; j += kLanes) {
+        k.j = j;
+        k.n = std::min((int)kLanes, count - j);
+        k.dst = dst + j;
+        k.coverage = coverage ? coverage + j : nullptr;
+        for (int i = 0; i < shade.count; i ++) {
+            gStages[shade.stages[i]](k, shade.contexts[i]);
+        }
+
+        int blend = kMixed;
+        if (classify) {
+            GPixel all = ~0u, any = 0;
+            for (int i = 0; i < k.n; i ++) {
+                all &= k.src[i];
+                any |= k.src[i];
+            }
+            blend = GPixel_GetA(any) == 0 ? kTransparent : GPixel_GetA(all) == 255 ? kOpaque : kMixed;
+        }
+        gBlendStages[(int)blends[blend]](k, nullptr);
+    }
+}
+
+void GRasterPipeline::shadeRow(int x, int y, int count, GPixel row[]) const {
+    Block k;
+    k.x = x;
+    k.y = y;
+    k.dst = nullptr;
+    k.coverage = nullptr;
+    for (int j = 0; j < count; j += kLanes) {
+        k.j = j;
+        k.n = std::min((int)kLanes, count - j);
+        for (int i = 0; i < shade.count; i ++) {
+            gStages[shade.stages[i]](k, shade.contexts[i]);
+        }
+        memcpy(row + j, k.src, k.n * sizeof(GPixel));
+    }
+}
@@ -6,7 +6,9 @@
 #include "../include/GCanvas.h"
 #include "../include/GBitmap.h"
 #include "../include/GTime.h"
+#include <atomic>
 #include <memory>
+#include <new>
 #include <string>
 #include <vector>
 #include <sys/stat.h>
@@ -14,6 +16,22 @@
 
 constexpr double gMaxBenchMultiplier = 32;   // times slower than mine
 
+// Every heap allocation made by the bench binary, for --allocs
+static std::atomic<long> gHeapAllocs(0);
+
+void* operator new(size_t size) {
+    gHeapAllocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
 static void setup_bitmap(GBitmap* bitmap, int w, int h) {
     size_t rb = w * sizeof(GPixel);
     bitmap->reset(w, h, rb, (GPixel*)calloc(h, rb), GBitmap::kNo_IsOpaque);
@@ -25,11 +43,16 @@ enum Mode {
     kOnce,
 };
 
-static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap, Mode mode) {
+/**
+ *  Returns the average ms per draw. If allocsPerDraw is not null, the bench is then drawn a few
+ *  more times (its caches now warm) to count the heap allocations each draw makes.
+ */
+static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap, Mode mode,
+                          int threads = 1, double* allocsPerDraw = nullptr) {
     GISize size = bench->size();
     setup_bitmap(bitmap, size.fWidth, size.fHeight);
 
-    auto canvas = GCreateCanvas(*bitmap);
+    auto canvas = GCreateCanvas(*bitmap, threads);
     if (!canvas) {
         fprintf(stderr, "failed to create canvas for [%d %d] %s\n",
                 size.fWidth, size.fHeight, bench->name());
@@ -53,6 +76,15 @@ static double handle_proc(GBenchmark* bench, const char path[], GBitmap* bitmap,
         bench->draw(canvas.get());
     }
     GMSec dur = GTime::GetMSec() - now;
+
+    if (allocsPerDraw) {
+        constexpr int kAllocDraws = 4;
+        long before = gHeapAllocs.load();
+        for (int i = 0; i < kAllocDraws; ++i) {
+            bench->draw(canvas.get());
+        }
+        *allocsPerDraw = (gHeapAllocs.load() - before) * 1.0 / kAllocDraws;
+    }
     return dur * 1.0 / N;
 }
 
@@ -94,6 +126,8 @@ int main_bench(int argc, const char* argv[]) {
     std::vector<double> inScores;
     bool chatty_mode = true;
     bool write_images = false;
+    int max_threads = 0;
+    bool count_allocs = false;
 
     int count = -1;
     while (gBenchFactories[++count]);
@@ -118,6 +152,10 @@ int main_bench(int argc, const char* argv[]) {
             chatty_mode = false;
         } else if (is_arg(argv[i], "writeImages")) {
             write_images = true;
+        } else if (is_arg(argv[i], "threads") && i+1 < argc) {
+            max_threads = atoi(argv[++i]);
+        } else if (is_arg(argv[i], "allocs")) {
+            count_allocs = true;
         } else {
             printf("Unknown arg %s\n", argv[i]);
             return -1;
@@ -140,9 +178,28 @@ int main_bench(int argc, const char* argv[]) {
         }
 
         GBitmap testBM;
-        double dur = handle_proc(bench.get(), name, &testBM, mode);
+        double allocs = 0;
+        double dur = handle_proc(bench.get(), name, &testBM, mode, 1, count_allocs ? &allocs : nullptr);
         if (chatty_mode) {
             printf("%s %g", name, dur);
+            if (count_allocs) {
+                printf("  allocs/draw %g", allocs);
+                if (const char* why = bench->allocates()) {
+                    printf(" (%s)", why);
+                }
+            }
+            std::string stats = bench->stats();
+            if (!stats.empty()) {
+                printf("  %s", stats.c_str());
+            }
+        }
+        // report the speedup of the tiled canvas for 2, 4, ... max_threads threads
+        for (int t = 2; t <= max_threads; t *= 2) {
+            free(testBM.pixels());
+            double tdur = handle_proc(bench.get(), name, &testBM, mode, t);
+            if (chatty_mode) {
+                printf("  %dt %g [%.2fx]", t, tdur, dur / tdur);
+            }
         }
         if (inScores.size()) {
             double quo = std::min(dur / inScores[i], gMaxBenchMultiplier);
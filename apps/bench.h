@@ -6,6 +6,7 @@
 #define _bench_h_DEFINED
 
 #include "../include/GPoint.h"
+#include <string>
 
 class GCanvas;
 
@@ -17,6 +18,17 @@ public:
     virtual GISize size() const = 0;
     virtual void draw(GCanvas*) = 0;
 
+    /**
+     *  Optional measurement of the draws so far, printed after the timing (e.g. "px/frame 1200").
+     */
+    virtual std::string stats() const { return std::string(); }
+
+    /**
+     *  Why each draw allocates on purpose, if it does (e.g. "records each frame"). Printed by
+     *  --allocs next to the count; Other benches should count 0 once their caches are warm.
+     */
+    virtual const char* allocates() const { return nullptr; }
+
     typedef GBenchmark* (*Factory)();
 };
 
@@ -16,6 +16,7 @@
 #include "bench_pa4.inc"
 #include "bench_pa5.inc"
 #include "bench_pa6.inc"
+#include "bench_perf.inc"
 
 const GBenchmark::Factory gBenchFactories[] {
     // pa1
@@ -97,5 +98,23 @@ const GBenchmark::Factory gBenchFactories[] {
         return new MeshBench(verts, colors, verts, 2, indices, "mesh_both");
      },
 
+    // perf
+    []() -> GBenchmark* { return new HugePathBench(10000,  "path_huge_10k");  },
+    []() -> GBenchmark* { return new HugePathBench(30000,  "path_huge_30k");  },
+    []() -> GBenchmark* { return new HugePathBench(100000, "path_huge_100k"); },
+    []() -> GBenchmark* { return new HugePathBench(10000,  "path_banded_10k",  true); },
+    []() -> GBenchmark* { return new HugePathBench(30000,  "path_banded_30k",  true); },
+    []() -> GBenchmark* { return new HugePathBench(100000, "path_banded_100k", true); },
+    []() -> GBenchmark* { return new AABench(false); },
+    []() -> GBenchmark* { return new AABench(true);  },
+    []() -> GBenchmark* { return new SceneBench4K(); },
+    []() -> GBenchmark* { return new WarpGridBench(false); },
+    []() -> GBenchmark* { return new WarpGridBench(true);  },
+    []() -> GBenchmark* { return new BounceBench(false); },
+    []() -> GBenchmark* { return new BounceBench(true);  },
+    []() -> GBenchmark* { return new OcclusionBench(false); },
+    []() -> GBenchmark* { return new OcclusionBench(true);  },
+    []() -> GBenchmark* { return new ClearBench4K(); },
+
     nullptr,
 };
@@ -0,0 +1,903 @@
+/**
+ *  Tests for the rasterizer features beyond the assignments.
+ */
+
+#include "../include/GCanvas.h"
+#include "../include/GBitmap.h"
+#include "../include/GPath.h"
+#include "../include/GPicture.h"
+#include "../include/GRandom.h"
+#include "../GBlitter.h"
+#include "../GThreadPool.h"
+#include "tests.h"
+
+// Rotated convex polygons put edges at every slope and row phase; The stepped X must land on the same
+// pixels as the reference rendering of the color_clock image
+static void test_rotated_polygon_matches_expected(GTestStats* stats) {
+    GBitmap expected;
+    if (!expected.readFromFile("expected/color_clock.png")) {
+        EXPECT_TRUE(stats, false);
+        return;
+    }
+
+    GSurface surface(expected.width(), expected.height());
+    GCanvas* canvas = surface.canvas();
+    canvas->clear({0, 0, 0, 0});
+    const GPoint pts[] {
+        { 0, 0.1f }, { -1, 5 }, { 0, 6 }, { 1, 5 },
+    };
+    canvas->translate(150, 150);
+    canvas->scale(25, 25);
+    float steps = 12;
+    float r = 0, b = 1;
+    for (float angle = 0; angle < 2*M_PI - 0.001f; angle += 2*M_PI/steps) {
+        canvas->save();
+        canvas->rotate(angle);
+        canvas->drawConvexPolygon(pts, 4, GPaint({r, 0, b, 1}));
+        canvas->restore();
+        r += 1 / (steps - 1);
+        b -= 1 / (steps - 1);
+    }
+
+    const GBitmap& bm = surface.bitmap();
+    int diffs = 0;
+    for (int y = 0; y < bm.height(); y ++) {
+        for (int x = 0; x < bm.width(); x ++) {
+            diffs += *bm.getAddr(x, y) != *expected.getAddr(x, y);
+        }
+    }
+    EXPECT_EQ(stats, diffs, 0);
+    free(expected.pixels());
+}
+
+static void test_aa_rect_coverage(GTestStats* stats) {
+    GSurface surface(4, 1);
+    surface.canvas()->clear({0, 0, 0, 0});
+
+    GPaint paint({0, 0, 0, 1});
+    paint.setAntiAlias(true);
+    surface.canvas()->drawRect(GRect::LTRB(0.5f, 0, 2.25f, 1), paint);
+
+    const GBitmap& bm = surface.bitmap();
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(0, 0)), 128);
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(1, 0)), 255);
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(2, 0)), 64);
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(3, 0)), 0);
+}
+
+static void test_aa_path_winding(GTestStats* stats) {
+    GSurface surface(20, 20);
+    surface.canvas()->clear({0, 0, 0, 0});
+
+    // Two overlapping rects with the same direction must not double the coverage
+    GPath path;
+    path.addRect(GRect::LTRB(2, 2, 12, 12));
+    path.addRect(GRect::LTRB(6, 6, 16.5f, 16));
+    GPaint paint({0, 0, 0, 1});
+    paint.setAntiAlias(true);
+    surface.canvas()->drawPath(path, paint);
+
+    const GBitmap& bm = surface.bitmap();
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(8, 8)), 255);
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(16, 10)), 128);
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(1, 1)), 0);
+}
+
+static void draw_tiling_scene(GCanvas* canvas) {
+    canvas->clear({1, 1, 1, 1});
+    canvas->drawRect(GRect::LTRB(10.3f, 5.7f, 290.2f, 190.6f), GPaint({1, 0, 0, 0.5f}));
+
+    GPath path;
+    path.addCircle({150, 100}, 90);
+    path.addCircle({100, 60}, 50, GPath::kCCW_Direction);
+    GPaint paint({0, 0.5f, 1, 0.75f});
+    canvas->drawPath(path, paint);
+
+    canvas->rotate(0.3f);
+    paint.setAntiAlias(true);
+    canvas->drawPath(path, paint);
+    canvas->drawRect(GRect::LTRB(40, 20, 200, 120), GPaint({0, 1, 0, 0.5f}));
+
+    // Many small, overlapping translucent triangles, binned per tile, must still blend in order
+    GRandom rand;
+    const int kTris = 300;
+    GPoint verts[3 * kTris];
+    GColor colors[3 * kTris];
+    int indices[3 * kTris];
+    for (int i = 0; i < 3 * kTris; i ++) {
+        GPoint center = {rand.nextF() * 300, rand.nextF() * 200};
+        verts[i] = {center.fX + rand.nextF() * 30 - 15, center.fY + rand.nextF() * 30 - 15};
+        colors[i] = {rand.nextF(), rand.nextF(), rand.nextF(), 0.6f};
+        indices[i] = i;
+    }
+    canvas->drawMesh(verts, colors, nullptr, kTris, indices, GPaint());
+
+    // A quad fine enough to be streamed a band at a time
+    const GPoint quad[4] = {{20, 10}, {180, 30}, {150, 170}, {10, 150}};
+    const GColor quadColors[4] = {{1, 0, 0, 0.5f}, {0, 1, 0, 1}, {0, 0, 1, 0.5f}, {1, 1, 0, 1}};
+    canvas->drawQuad(quad, quadColors, nullptr, 80, GPaint());
+}
+
+static void test_tiled_matches_serial(GTestStats* stats) {
+    // A worker of a larger pool is not a worker of the canvas' pool, so it gets slot 0 there
+    GThreadPool outer(8);
+    std::atomic<int> misplaced(0);
+    outer.parallelFor(8, [&](int) {
+        GThreadPool inner(2);
+        misplaced += inner.threadIndex() != 0;
+        GBitmap bm;
+        bm.alloc(300, 200);
+        draw_tiling_scene(GCreateCanvas(bm, 2).get());
+        free(bm.pixels());
+    });
+    EXPECT_EQ(stats, misplaced.load(), 0);
+
+    for (int threads : { 2, 3, 8 }) {
+        GBitmap serial, tiled;
+        serial.alloc(300, 200);
+        tiled.alloc(300, 200);
+        draw_tiling_scene(GCreateCanvas(serial).get());
+        draw_tiling_scene(GCreateCanvas(tiled, threads).get());
+        EXPECT_TRUE(stats, !memcmp(serial.pixels(), tiled.pixels(), serial.rowBytes() * serial.height()));
+        free(serial.pixels());
+        free(tiled.pixels());
+    }
+}
+
+static void draw_picture_scene(GCanvas* canvas) {
+    canvas->clear({1, 1, 1, 1});
+    // A grid of small rects with one paint: these get merged on playback
+    GPaint paint({0.2f, 0.4f, 0.8f, 0.6f});
+    for (int y = 0; y < 8; y ++) {
+        for (int x = 0; x < 10; x ++) {
+            canvas->drawRect(GRect::XYWH(x * 25 + 2.3f, y * 20 + 1.6f, 18.5f, 14.2f), paint);
+        }
+    }
+    GPoint tri[] = {{20, 170}, {140, 120}, {90, 195}};
+    canvas->drawConvexPolygon(tri, 3, paint);
+
+    canvas->save();
+    canvas->translate(150, 100);
+    canvas->rotate(0.4f);
+    GPath path;
+    path.addCircle({0, 0}, 60);
+    path.addRect(GRect::LTRB(-30, -30, 30, 30), GPath::kCCW_Direction);
+    canvas->drawPath(path, GPaint({1, 0, 0, 0.5f}));
+    canvas->drawRect(GRect::LTRB(70, -20, 120, 20), GPaint({1, 0, 0, 0.5f}));
+    canvas->restore();
+
+    GPoint verts[] = {{200, 120}, {290, 130}, {280, 195}, {210, 190}};
+    GColor colors[] = {{1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 1}, {1, 1, 0, 0.5f}};
+    canvas->drawQuad(verts, colors, nullptr, 2, GPaint());
+    int indices[] = {0, 1, 3};
+    canvas->drawMesh(verts, colors, nullptr, 1, indices, GPaint());
+
+    // Entirely outside the device; never recorded
+    canvas->drawRect(GRect::LTRB(-50, -50, -10, -10), GPaint({0, 0, 0, 1}));
+}
+
+static void test_picture_matches_direct(GTestStats* stats) {
+    GBitmap direct, played;
+    direct.alloc(300, 200);
+    played.alloc(300, 200);
+    draw_picture_scene(GCreateCanvas(direct).get());
+
+    auto recorder = GCreateRecordingCanvas({300, 200});
+    draw_picture_scene(recorder.get());
+    auto picture = recorder->finishRecording();
+    EXPECT_EQ(stats, picture->countOps(), 86);
+    picture->playback(GCreateCanvas(played).get());
+
+    EXPECT_TRUE(stats, !memcmp(direct.pixels(), played.pixels(), direct.rowBytes() * direct.height()));
+    free(direct.pixels());
+    free(played.pixels());
+}
+
+static void test_picture_culls_ops(GTestStats* stats) {
+    auto recorder = GCreateRecordingCanvas({40, 20});
+    recorder->drawRect(GRect::LTRB(2, 2, 8, 8), GPaint({0, 0, 0, 1}));
+    recorder->translate(20, 0);
+    recorder->drawRect(GRect::LTRB(2, 2, 8, 8), GPaint({0, 0, 0, 1}));
+    auto picture = recorder->finishRecording();
+    GIRect bounds = picture->bounds();
+    EXPECT_TRUE(stats, bounds.left() == 2 && bounds.top() == 2 && bounds.right() == 28 && bounds.bottom() == 8);
+
+    GSurface surface(40, 20);
+    surface.canvas()->clear({0, 0, 0, 0});
+    picture->playback(surface.canvas(), GIRect::LTRB(20, 0, 40, 20));
+    const GBitmap& bm = surface.bitmap();
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(5, 5)), 0);
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(25, 5)), 255);
+}
+
+static void test_picture_batch_cache(GTestStats* stats) {
+    // Three disjoint rects with one paint merge into one path when the picture is made
+    auto recorder = GCreateRecordingCanvas({40, 20});
+    for (int i = 0; i < 3; i ++) {
+        recorder->drawRect(GRect::XYWH(2 + i * 12, 2, 8, 8), GPaint({0, 0, 0, 1}));
+    }
+    auto picture = recorder->finishRecording();
+
+    // So playing it again reuses the merged path's edges, once they are kept on the second miss
+    GSurface surface(40, 20);
+    for (int i = 0; i < 3; i ++) {
+        picture->playback(surface.canvas());
+    }
+    GPathCacheStats after = surface.canvas()->getPathCacheStats();
+    EXPECT_TRUE(stats, after.misses == 2 && after.hits == 1);
+
+    // Only part of the run is in target: just those ops draw, and none of them as a path
+    surface.canvas()->clear({0, 0, 0, 0});
+    picture->playback(surface.canvas(), GIRect::LTRB(12, 0, 40, 20));
+    const GBitmap& bm = surface.bitmap();
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(5, 5)), 0);
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(17, 5)), 255);
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(29, 5)), 255);
+    EXPECT_TRUE(stats, surface.canvas()->getPathCacheStats().misses == after.misses);
+}
+
+static void test_path_bounds_and_guard_band(GTestStats* stats) {
+    GPath path;
+    path.moveTo(10, 20).lineTo(30, 25).lineTo(15, 40);
+    GRect r = path.bounds();
+    EXPECT_TRUE(stats, r.left() == 10 && r.top() == 20 && r.right() == 30 && r.bottom() == 40);
+
+    // Edges poking a few pixels past the left and right must still fill exactly the device columns
+    GSurface surface(10, 4);
+    surface.canvas()->clear({0, 0, 0, 0});
+    GPath wide;
+    wide.addRect(GRect::LTRB(-3.2f, 1, 12.6f, 3));
+    surface.canvas()->drawPath(wide, GPaint({0, 0, 0, 1}));
+    const GBitmap& bm = surface.bitmap();
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(0, 1)), 255);
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(9, 2)), 255);
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(0, 0)), 0);
+
+    // A contour entirely to the left of the device covers nothing, not column 0
+    GPath left;
+    left.addRect(GRect::LTRB(-8, 0, -2, 4));
+    left.addRect(GRect::LTRB(4, 0, 6, 1));
+    surface.canvas()->drawPath(left, GPaint({0, 0, 0, 1}));
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(0, 0)), 0);
+    EXPECT_EQ(stats, GPixel_GetA(*bm.getAddr(4, 0)), 255);
+}
+
+static void test_path_edge_cache(GTestStats* stats) {
+    GPath path;
+    path.addCircle({20, 20}, 15);
+    GPath copy = path;
+    EXPECT_TRUE(stats, copy.getGenerationID() == path.getGenerationID());
+    copy.lineTo(0, 0);
+    EXPECT_TRUE(stats, copy.getGenerationID() != path.getGenerationID());
+    // Asking again without a change keeps the ID; Any number of changes take one new ID, when asked
+    uint64_t id = copy.getGenerationID();
+    EXPECT_TRUE(stats, copy.getGenerationID() == id);
+    copy.lineTo(1, 1);
+    copy.lineTo(2, 2);
+    EXPECT_TRUE(stats, copy.getGenerationID() == id + 1);
+
+    // The edges are kept on the second miss, and reused from the third draw on
+    GSurface surface(40, 40);
+    GCanvas* canvas = surface.canvas();
+    canvas->setPathCacheLimit(1);
+    for (int i = 0; i < 3; i ++) {
+        canvas->drawPath(path, GPaint());
+    }
+    GPathCacheStats after = canvas->getPathCacheStats();
+    EXPECT_TRUE(stats, after.misses == 2 && after.hits == 1 && after.entries == 1);
+
+    // A path drawn once doesn't take the place of the one being redrawn
+    canvas->drawPath(copy, GPaint());
+    canvas->drawPath(path, GPaint());
+    GPathCacheStats oneShot = canvas->getPathCacheStats();
+    EXPECT_TRUE(stats, oneShot.misses - after.misses == 1 && oneShot.hits - after.hits == 1);
+
+    // A different CTM builds new edges
+    canvas->translate(1, 0);
+    canvas->drawPath(path, GPaint());
+    EXPECT_TRUE(stats, canvas->getPathCacheStats().misses - oneShot.misses == 1);
+
+    // Each canvas keeps its own edges
+    GSurface other(40, 40);
+    other.canvas()->drawPath(path, GPaint());
+    EXPECT_TRUE(stats, other.canvas()->getPathCacheStats().misses == 1);
+    EXPECT_TRUE(stats, canvas->getPathCacheStats().misses - oneShot.misses == 1);
+}
+
+static void test_mesh_plane_colors(GTestStats* stats) {
+    // Two triangles covering [0, 8) x [0, 8); Red along x, so every column has one color
+    const GPoint verts[] = {{0, 0}, {8, 0}, {8, 8}, {0, 8}};
+    const GColor colors[] = {{0, 0, 0, 1}, {1, 0, 0, 1}, {1, 0, 0, 1}, {0, 0, 0, 1}};
+    const int indices[] = {0, 1, 2, 0, 2, 3};
+    GSurface surface(8, 8);
+    surface.canvas()->drawMesh(verts, colors, nullptr, 2, indices, GPaint());
+
+    bool ok = true;
+    for (int y = 0; y < 8; y ++) {
+        for (int x = 0; x < 8; x ++) {
+            GPixel p = *surface.bitmap().getAddr(x, y);
+            int expected = GRoundToInt((x + 0.5f) / 8 * 255);
+            ok &= GPixel_GetA(p) == 255 && std::abs((int)GPixel_GetR(p) - expected) <= 1 &&
+                  GPixel_GetR(p) == GPixel_GetR(*surface.bitmap().getAddr(x, 0));
+        }
+    }
+    EXPECT_TRUE(stats, ok);
+}
+
+static void test_quad_streaming_matches_grid(GTestStats* stats) {
+    // Level 70 is past the buffered grid size, so drawQuad streams its rows
+    const int level = 70, n = level + 2;
+    const GPoint verts[] = {{3, 2}, {60, 8}, {55, 61}, {1, 50}};
+    const GColor colors[] = {{1, 0, 0, 1}, {0, 1, 0, 0.5f}, {0, 0, 1, 1}, {1, 1, 0, 0.75f}};
+    GSurface streamed(64, 64), gridded(64, 64);
+    streamed.canvas()->rotate(0.1f);
+    streamed.canvas()->drawQuad(verts, colors, nullptr, level, GPaint());
+
+    std::vector<GPoint> gridVerts;
+    std::vector<GColor> gridColors;
+    std::vector<int> indices;
+    for (int t = 0; t < n; t ++) {
+        float ft = (float)t / (level + 1);
+        GPoint p0 = verts[0] + (verts[3] - verts[0]) * ft, p1 = verts[1] + (verts[2] - verts[1]) * ft;
+        GColor c0 = colors[0] + (colors[3] - colors[0]) * ft, c1 = colors[1] + (colors[2] - colors[1]) * ft;
+        for (int s = 0; s < n; s ++) {
+            float fs = (float)s / (level + 1);
+            gridVerts.push_back(p0 + (p1 - p0) * fs);
+            gridColors.push_back(c0 + (c1 - c0) * fs);
+            if (t < n - 1 && s < n - 1) {
+                int quad[] = {t * n + s, t * n + s + 1, (t + 1) * n + s,
+                              (t + 1) * n + s, t * n + s + 1, (t + 1) * n + s + 1};
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+    }
+    gridded.canvas()->rotate(0.1f);
+    gridded.canvas()->drawMesh(gridVerts.data(), gridColors.data(), nullptr,
+                               (int)indices.size() / 3, indices.data(), GPaint());
+
+    const GBitmap& a = streamed.bitmap();
+    const GBitmap& b = gridded.bitmap();
+    bool same = true;
+    for (int y = 0; y < 64; y ++) {
+        same &= !memcmp(a.getAddr(0, y), b.getAddr(0, y), 64 * sizeof(GPixel));
+    }
+    EXPECT_TRUE(stats, same);
+}
+
+// Largest difference of any channel, over the pixels drawn in both bitmaps
+static int max_channel_diff(const GBitmap& a, const GBitmap& b) {
+    int diff = 0;
+    for (int y = 0; y < a.height(); y ++) {
+        for (int x = 0; x < a.width(); x ++) {
+            GPixel p = *a.getAddr(x, y), q = *b.getAddr(x, y);
+            if (p == 0 || q == 0) continue;
+            for (int shift = 0; shift < 32; shift += 8) {
+                diff = std::max(diff, std::abs((int)((p >> shift) & 0xFF) - (int)((q >> shift) & 0xFF)));
+            }
+        }
+    }
+    return diff;
+}
+
+static void test_quad_auto_level(GTestStats* stats) {
+    const GColor colors[] = {{1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 1}, {1, 1, 1, 1}};
+
+    // A tiny quad is drawn as 2 triangles
+    const GPoint tiny[] = {{10, 10}, {11.5f, 10}, {11.5f, 11.5f}, {10, 11.5f}};
+    GSurface autoTiny(32, 32), flatTiny(32, 32);
+    autoTiny.canvas()->drawQuadAuto(tiny, colors, nullptr, 0.25f, GPaint());
+    flatTiny.canvas()->drawQuad(tiny, colors, nullptr, 0, GPaint());
+    EXPECT_TRUE(stats, max_channel_diff(autoTiny.bitmap(), flatTiny.bitmap()) == 0);
+
+    // A large warped quad subdivides until it is close to a very fine tessellation
+    const GPoint warped[] = {{2, 4}, {120, 10}, {70, 60}, {6, 124}};
+    GSurface autoWarped(128, 128), fine(128, 128), coarse(128, 128);
+    autoWarped.canvas()->drawQuadAuto(warped, colors, nullptr, 0.25f, GPaint());
+    fine.canvas()->drawQuad(warped, colors, nullptr, 100, GPaint());
+    coarse.canvas()->drawQuad(warped, colors, nullptr, 0, GPaint());
+    // (Pixels whose centers fall just outside a triangle extrapolate its colors, so the
+    // tessellations never agree exactly along the cells' edges)
+    EXPECT_TRUE(stats, max_channel_diff(autoWarped.bitmap(), fine.bitmap()) <= 16);
+    EXPECT_TRUE(stats, max_channel_diff(coarse.bitmap(), fine.bitmap()) > 64);
+}
+
+static bool same_pixels(const GBitmap& a, const GBitmap& b) {
+    for (int y = 0; y < a.height(); y ++) {
+        if (memcmp(a.getAddr(0, y), b.getAddr(0, y), a.width() * sizeof(GPixel))) return false;
+    }
+    return true;
+}
+
+static void test_active_edge_table_many_edges(GTestStats* stats) {
+    // ~24k edges over 96 rows, hundreds of them active on every row, some past the device;
+    // All wound the same way, so overlaps never cancel out
+    const int kPolys = 3000, kSides = 8;
+    GRandom rand;
+    GPath whole;
+    std::vector<GPoint> pts;
+    for (int i = 0; i < kPolys; i ++) {
+        GPoint center = {rand.nextF() * 124 + 14, rand.nextF() * 108 - 6};
+        float radius = 1 + rand.nextF() * 12;
+        float phase = rand.nextF() * 2 * M_PI;
+        for (int k = 0; k < kSides; k ++) {
+            float angle = phase + k * 2 * M_PI / kSides;
+            pts.push_back({center.fX + cosf(angle) * radius, center.fY + sinf(angle) * radius});
+        }
+        whole.addPolygon(&pts[i * kSides], kSides);
+    }
+
+    // The baseline walks each polygon on its own, with no edge list or sorting
+    GSurface baseline(128, 96);
+    baseline.canvas()->clear({0, 0, 0, 0});
+    baseline.canvas()->rotate(0.05f);
+    for (int i = 0; i < kPolys; i ++) {
+        baseline.canvas()->drawConvexPolygon(&pts[i * kSides], kSides, GPaint({0, 0, 0, 1}));
+    }
+
+    for (int threads : { 1, 3 }) {
+        GBitmap bm;
+        bm.alloc(128, 96);
+        auto canvas = GCreateCanvas(bm, threads);
+        canvas->clear({0, 0, 0, 0});
+        canvas->rotate(0.05f);
+        canvas->drawPath(whole, GPaint({0, 0, 0, 1}));
+        EXPECT_TRUE(stats, same_pixels(bm, baseline.bitmap()));
+        free(bm.pixels());
+    }
+}
+
+static void test_clip_rect(GTestStats* stats) {
+    GSurface clipped(40, 40), expected(40, 40);
+    GCanvas* canvas = clipped.canvas();
+    canvas->save();
+    canvas->translate(10, 10);
+    canvas->clipRect(GRect::LTRB(0.4f, 2.6f, 15.5f, 20));
+    canvas->clipRect(GRect::LTRB(-5, -5, 12.2f, 17));
+    canvas->drawPaint(GPaint({1, 0, 0, 1}));
+    canvas->restore();
+    // Back to unclipped
+    canvas->drawRect(GRect::LTRB(30, 30, 40, 40), GPaint({0, 0, 1, 1}));
+
+    expected.canvas()->drawRect(GRect::LTRB(10.4f, 12.6f, 22.2f, 27), GPaint({1, 0, 0, 1}));
+    expected.canvas()->drawRect(GRect::LTRB(30, 30, 40, 40), GPaint({0, 0, 1, 1}));
+    EXPECT_TRUE(stats, same_pixels(clipped.bitmap(), expected.bitmap()));
+
+    // A draw outside the clip is dropped before its edges are built
+    GPath path;
+    path.addCircle({5, 5}, 4);
+    canvas->clipRect(GRect::LTRB(20, 20, 40, 40));
+    GPathCacheStats before = canvas->getPathCacheStats();
+    canvas->drawPath(path, GPaint());
+    GPathCacheStats after = canvas->getPathCacheStats();
+    EXPECT_TRUE(stats, after.misses == before.misses && after.hits == before.hits);
+}
+
+static void test_clip_path_mask(GTestStats* stats) {
+    GPath circle;
+    circle.addCircle({20, 18}, 13.3f);
+    for (int aa = 0; aa <= 1; aa ++) {
+        // Filling through the path clip covers the same pixels, by the same amount, as the path
+        GSurface clipped(40, 40), expected(40, 40);
+        clipped.canvas()->clipRect(GRect::LTRB(0, 10, 40, 40));
+        clipped.canvas()->clipPath(circle, aa != 0);
+        clipped.canvas()->drawRect(GRect::LTRB(-5, -5, 50, 50), GPaint({0, 0.5f, 0, 1}));
+
+        GPaint paint({0, 0.5f, 0, 1});
+        paint.setAntiAlias(aa != 0);
+        expected.canvas()->clipRect(GRect::LTRB(0, 10, 40, 40));
+        expected.canvas()->drawPath(circle, paint);
+        EXPECT_TRUE(stats, same_pixels(clipped.bitmap(), expected.bitmap()));
+    }
+}
+
+static void draw_clipped_scene(GCanvas* canvas) {
+    canvas->clear({1, 1, 1, 1});
+    canvas->save();
+    canvas->clipRect(GRect::LTRB(10, 10, 90, 70));
+    canvas->rotate(0.2f);
+    GPath star;
+    star.addCircle({50, 40}, 30);
+    canvas->clipPath(star, true);
+    canvas->drawRect(GRect::LTRB(0, 0, 100, 40), GPaint({1, 0, 0, 0.75f}));
+    canvas->drawRect(GRect::LTRB(0, 40, 100, 80), GPaint({0, 0, 1, 0.75f}));
+    canvas->restore();
+    canvas->drawRect(GRect::LTRB(60, 60, 100, 80), GPaint({0, 1, 0, 0.5f}));
+}
+
+static void test_picture_records_clips(GTestStats* stats) {
+    GSurface direct(100, 80), played(100, 80);
+    draw_clipped_scene(direct.canvas());
+    auto recorder = GCreateRecordingCanvas({100, 80});
+    draw_clipped_scene(recorder.get());
+    recorder->finishRecording()->playback(played.canvas());
+    EXPECT_TRUE(stats, same_pixels(direct.bitmap(), played.bitmap()));
+
+    // Tiles share the clip mask
+    GBitmap tiled;
+    tiled.alloc(100, 80);
+    draw_clipped_scene(GCreateCanvas(tiled, 4).get());
+    EXPECT_TRUE(stats, same_pixels(direct.bitmap(), tiled));
+    free(tiled.pixels());
+}
+
+static std::shared_ptr<const GPicture> record_bounce_frame(int frame) {
+    auto recorder = GCreateRecordingCanvas({120, 90});
+    recorder->drawPaint(GPaint({1, 1, 1, 1}));
+    recorder->drawRect(GRect::LTRB(5, 5, 30, 30), GPaint({1, 0, 0, 1}));  // never moves
+    GPath path;
+    path.addCircle({20.5f + frame * 7.3f, 45}, 12);
+    GPaint aa({0.5f, 0, 0, 1});
+    aa.setAntiAlias(true);
+    recorder->drawPath(path, aa);
+    if (frame % 2) {
+        recorder->drawRect(GRect::LTRB(90, 60, 110, 80), GPaint({0, 1, 0, 1}));  // blinks
+    }
+    return recorder->finishRecording();
+}
+
+static void test_damage_tracker(GTestStats* stats) {
+    GSurface tracked(120, 90), full(120, 90);
+    GDamageTracker tracker(2);
+    for (int frame = 0; frame < 6; frame ++) {
+        auto picture = record_bounce_frame(frame);
+        tracker.draw(picture, tracked.canvas());
+        picture->playback(full.canvas());
+        EXPECT_TRUE(stats, same_pixels(tracked.bitmap(), full.bitmap()));
+        if (frame == 0) {
+            EXPECT_TRUE(stats, tracker.pixelsRedrawn() == 120 * 90);
+        } else {
+            EXPECT_TRUE(stats, tracker.pixelsRedrawn() > 0 && tracker.pixelsRedrawn() < 120 * 90 / 2);
+        }
+    }
+    // Nothing changed, nothing redrawn
+    tracker.draw(record_bounce_frame(5), tracked.canvas());
+    EXPECT_TRUE(stats, tracker.pixelsRedrawn() == 0);
+}
+
+static void test_cull_occluded(GTestStats* stats) {
+    auto recorder = GCreateRecordingCanvas({100, 80});
+    recorder->drawPaint(GPaint({0.5f, 0.5f, 0.5f, 1}));
+    GPaint aa({1, 0, 0, 1});
+    aa.setAntiAlias(true);
+    recorder->drawRect(GRect::LTRB(10.3f, 10.7f, 50.2f, 40.5f), aa);  // partly under the panel
+    GPath circle;
+    circle.addCircle({80, 20}, 10);
+    recorder->drawPath(circle, aa);                                    // entirely under the panel
+    recorder->drawRect(GRect::LTRB(20, 50, 70, 75), GPaint({0, 0, 1, 0.5f}));
+    recorder->drawRect(GRect::LTRB(0, 0, 100.4f, 40.6f), aa);          // the panel
+    GPaint src({0, 1, 0, 0.25f});
+    src.setBlendMode(GBlendMode::kSrc);
+    recorder->drawRect(GRect::LTRB(60, 50, 100, 80), src);             // translucent, but replaces
+    auto picture = recorder->finishRecording();
+
+    GOcclusionStats culled;
+    auto cheaper = picture->cullOccluded(&culled);
+    EXPECT_TRUE(stats, culled.opsDropped == 1);
+    EXPECT_TRUE(stats, culled.opsClipped == 2);
+    EXPECT_TRUE(stats, culled.pixelsSaved > 0);
+    EXPECT_TRUE(stats, cheaper->countOps() == picture->countOps() - 1);
+
+    GSurface expected(100, 80), actual(100, 80);
+    picture->playback(expected.canvas());
+    cheaper->playback(actual.canvas());
+    EXPECT_TRUE(stats, same_pixels(expected.bitmap(), actual.bitmap()));
+}
+
+static void test_cull_by_shader_opacity(GTestStats* stats) {
+    // Every color of a gradient counts, the last one too
+    const GColor rgb[] = {{1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 1}};
+    const GColor fading[] = {{1, 0, 0, 1}, {0, 1, 0, 1}, {0, 0, 1, 0.5f}};
+    const GColor green[] = {{0, 1, 0, 1}};
+    const GColor clear[] = {{0, 1, 0, 0.5f}};
+    auto opaque = GCreateLinearGradient({0, 0}, {40, 0}, rgb, 3);
+    auto faded = GCreateLinearGradient({0, 0}, {40, 0}, fading, 3);
+    auto solid = GCreateLinearGradient({0, 0}, {40, 0}, green, 1);
+    auto tinted = GCreateLinearGradient({0, 0}, {40, 0}, clear, 1);
+    EXPECT_TRUE(stats, opaque->isOpaque() && !faded->isOpaque());
+    EXPECT_TRUE(stats, solid->isOpaque() && !tinted->isOpaque());
+
+    // So only the opaque shaders hide the rect under them
+    GShader* shaders[] = { opaque.get(), faded.get(), solid.get(), tinted.get() };
+    const int hides[] = { 1, 0, 1, 0 };
+    for (int i = 0; i < 4; i ++) {
+        GShader* shader = shaders[i];
+        auto recorder = GCreateRecordingCanvas({40, 20});
+        recorder->drawRect(GRect::LTRB(5, 5, 35, 15), GPaint({1, 0, 0, 1}));
+        recorder->drawRect(GRect::WH(40, 20), GPaint(shader));
+        auto picture = recorder->finishRecording();
+
+        GOcclusionStats culled;
+        auto cheaper = picture->cullOccluded(&culled);
+        EXPECT_EQ(stats, culled.opsDropped, hides[i]);
+
+        GSurface expected(40, 20), actual(40, 20);
+        picture->playback(expected.canvas());
+        cheaper->playback(actual.canvas());
+        EXPECT_TRUE(stats, same_pixels(expected.bitmap(), actual.bitmap()));
+        // The red shows through wherever the shader is translucent
+        EXPECT_EQ(stats, GPixel_GetR(*actual.bitmap().getAddr(34, 10)) > 0, !hides[i]);
+    }
+}
+
+static GPixel random_premul_pixel(GRandom& rand) {
+    // Mostly translucent, with some of each extreme
+    unsigned a = rand.nextU() % 3 == 0 ? (rand.nextU() & 1) * 255 : rand.nextU() & 0xFF;
+    return GPixel_PackARGB(a, rand.nextU() % (a + 1), rand.nextU() % (a + 1), rand.nextU() % (a + 1));
+}
+
+// The scalar blender of each GBlendMode, in enum order
+static const blender gScalarBlenders[] = {
+    Blenders::blendClear, Blenders::blendSrc, Blenders::blendDst, Blenders::blendSrcOver,
+    Blenders::blendDstOver, Blenders::blendSrcIn, Blenders::blendDstIn, Blenders::blendSrcOut,
+    Blenders::blendDstOut, Blenders::blendSrcATop, Blenders::blendDstATop, Blenders::blendXor,
+};
+
+/// @brief Blend a row with a vector kernel, or with none, finishing with the scalar blender.
+static void blend_row_with(GBlendRowSimdProc proc, blender b, GBlendMode mode, GPixel dst[], GPixel src[],
+                           bool srcIsRow, const uint8_t coverage[], int count) {
+    for (int x = proc ? proc(mode, dst, src, srcIsRow, coverage, count) : 0; x < count; x ++) {
+        GPixel blended = b(srcIsRow ? src[x] : src[0], dst[x]);
+        dst[x] = coverage ? Blenders::lerpByCoverage(blended, dst[x], coverage[x]) : blended;
+    }
+}
+
+static void test_blend_row_simd(GTestStats* stats) {
+    std::vector<GBlendRowSimdProc> procs = {GBlendRowSSE2};
+    if (GCpuHasAVX2()) {
+        procs.push_back(GBlendRowAVX2);
+    }
+
+    enum { N = 37 }; // not a multiple of any vector width, so the scalar tail runs too
+    GRandom rand;
+    GPixel src[N], dst[N], expected[N], actual[N];
+    uint8_t coverage[N];
+    for (int m = 0; m < GARRAY_COUNT(gScalarBlenders); m ++) {
+        GBlendMode mode = (GBlendMode)m;
+        for (int trial = 0; trial < 8; trial ++) {
+            for (int i = 0; i < N; i ++) {
+                src[i] = random_premul_pixel(rand);
+                dst[i] = random_premul_pixel(rand);
+                coverage[i] = rand.nextU() % 4 == 0 ? 255 : rand.nextU() & 0xFF;
+            }
+            bool srcIsRow = trial & 1;
+            const uint8_t* cov = trial & 2 ? coverage : nullptr;
+            memcpy(expected, dst, sizeof(dst));
+            blend_row_with(nullptr, gScalarBlenders[m], mode, expected, src, srcIsRow, cov, N);
+            for (GBlendRowSimdProc proc : procs) {
+                memcpy(actual, dst, sizeof(dst));
+                blend_row_with(proc, gScalarBlenders[m], mode, actual, src, srcIsRow, cov, N);
+                EXPECT_TRUE(stats, !memcmp(actual, expected, sizeof(actual)));
+            }
+        }
+    }
+}
+
+static void test_blend_reduction(GTestStats* stats) {
+    GRandom rand;
+    // A reduced mode gives the same pixels for sources of its alpha
+    for (int m = 0; m < GARRAY_COUNT(gScalarBlenders); m ++) {
+        for (int i = 0; i < 100; i ++) {
+            GPixel dst = random_premul_pixel(rand);
+            GPixel opaque = random_premul_pixel(rand) | 0xFF000000;
+            int opaqueMode = (int)GReduceBlendMode((GBlendMode)m, 255);
+            int clearMode = (int)GReduceBlendMode((GBlendMode)m, 0);
+            EXPECT_TRUE(stats, gScalarBlenders[opaqueMode](opaque, dst) == gScalarBlenders[m](opaque, dst));
+            EXPECT_TRUE(stats, gScalarBlenders[clearMode](0, dst) == gScalarBlenders[m](0, dst));
+        }
+    }
+
+    // Rows split into transparent, opaque and mixed runs blend like whole rows; Runs of 20
+    // pixels are too short to be blended apart, runs of 60 are not
+    enum { N = 360 };
+    GPixel src[N], dst[N], expected[N];
+    uint8_t coverage[N];
+    for (int m = 0; m < GARRAY_COUNT(gScalarBlenders); m ++) {
+        if ((GBlendMode)m == GBlendMode::kDst) continue; // skipped outright, even with coverage
+        for (int trial = 0; trial < 2; trial ++) {
+            for (int i = 0; i < N; i ++) {
+                int run = (i < N / 3 ? i / 20 : i / 60) % 3;
+                src[i] = run == 0 ? 0 : run == 1 ? random_premul_pixel(rand) | 0xFF000000 : random_premul_pixel(rand);
+                dst[i] = expected[i] = random_premul_pixel(rand);
+                coverage[i] = rand.nextU() & 0xFF;
+            }
+            const uint8_t* cov = trial ? coverage : nullptr;
+            blend_row_with(nullptr, gScalarBlenders[m], (GBlendMode)m, expected, src, true, cov, N);
+            GBlitter((GBlendMode)m).blendRow(dst, src, cov, N);
+            EXPECT_TRUE(stats, !memcmp(dst, expected, sizeof(dst)));
+        }
+    }
+}
+
+static void test_solid_fill(GTestStats* stats) {
+    // Every alignment and length, with and without streaming, stays inside its pixels
+    enum { N = 80 };
+    uint32_t row[N + 8];
+    for (int streaming = 0; streaming < 2; streaming ++) {
+        for (int offset = 0; offset < 4; offset ++) {
+            for (int count = 0; count <= N; count += count < 20 ? 1 : 13) {
+                memset(row, 0xAB, sizeof(row));
+                GFillRow(row + offset, 0x80402010, count, streaming);
+                bool ok = true;
+                for (int i = 0; i < N + 8; i ++) {
+                    bool inside = i >= offset && i < offset + count;
+                    ok &= row[i] == (inside ? 0x80402010u : 0xABABABABu);
+                }
+                EXPECT_TRUE(stats, ok);
+            }
+        }
+    }
+
+    // Clears and opaque rects on a bitmap whose rows are padded leave the padding alone,
+    // serially and tiled
+    enum { W = 130, H = 300, kPad = 3 };
+    for (int threads : { 1, 4 }) {
+        GBitmap bitmap;
+        bitmap.alloc(W, H, (W + kPad) * sizeof(GPixel));
+        memset(bitmap.pixels(), 0xAB, bitmap.rowBytes() * H);
+        auto canvas = GCreateCanvas(bitmap, threads);
+        canvas->clear({0, 0, 1, 1});
+        canvas->drawRect(GRect::LTRB(10, 20, 50, 290), GPaint({1, 0, 0, 1}));
+        canvas->save();
+        canvas->clipRect(GRect::LTRB(60, 0, 100, 100));
+        canvas->clear({0, 1, 0, 1});
+        canvas->restore();
+
+        GPixel blue = GPixel_PackARGB(255, 0, 0, 255), red = GPixel_PackARGB(255, 255, 0, 0);
+        GPixel green = GPixel_PackARGB(255, 0, 255, 0);
+        bool ok = true;
+        for (int y = 0; y < H; y ++) {
+            const GPixel* p = bitmap.getAddr(0, y);
+            for (int x = 0; x < W; x ++) {
+                GPixel expected = x >= 10 && x < 50 && y >= 20 && y < 290 ? red
+                                : x >= 60 && x < 100 && y < 100 ? green : blue;
+                ok &= p[x] == expected;
+            }
+            for (int x = W; x < W + kPad; x ++) {
+                ok &= p[x] == 0xABABABABu;
+            }
+        }
+        EXPECT_TRUE(stats, ok);
+        free(bitmap.pixels());
+    }
+}
+
+static void test_two_color_gradient_row(GTestStats* stats) {
+    // A clamped row starts left of the gradient and ends right of it; Every pixel is shaded
+    const GColor colors[] = {{1, 0, 0, 1}, {0, 0, 1, 1}};
+    auto shader = GCreateLinearGradient({10, 0}, {30, 0}, colors, 2);
+    shader->setContext(GMatrix());
+    GPixel row[40] = {};
+    shader->shadeRow(0, 0, 40, row);
+    EXPECT_EQ(stats, row[0], GPixel_PackARGB(255, 255, 0, 0));
+    EXPECT_TRUE(stats, GPixel_GetR(row[20]) > 0 && GPixel_GetB(row[20]) > 0);
+    EXPECT_EQ(stats, row[39], GPixel_PackARGB(255, 0, 0, 255));
+}
+
+static void test_raster_pipeline(GTestStats* stats) {
+    GRandom rand;
+    GBitmap opaque, translucent;
+    opaque.alloc(37, 23);
+    translucent.alloc(37, 23);
+    for (int y = 0; y < 23; y ++) {
+        for (int x = 0; x < 37; x ++) {
+            *opaque.getAddr(x, y) = random_premul_pixel(rand) | 0xFF000000;
+            // Whole rows of clear pixels, so some blocks are all transparent
+            *translucent.getAddr(x, y) = y % 5 == 0 ? 0 : random_premul_pixel(rand);
+        }
+    }
+    const GColor colors[] = {{1, 0, 0, 1}, {0.2f, 1, 0.5f, 0.6f}, {0, 0, 1, 0}, {1, 1, 1, 1}};
+    const GShader::TileMode tiles[] = {GShader::kClamp, GShader::kRepeat, GShader::kMirror};
+    GMatrix ctm = GMatrix::Concat(GMatrix::Rotate(0.3f), GMatrix::Scale(1.7f, 0.8f));
+
+    // Shaders drawn through their stages give the pixels of their shadeRow, blended by the
+    // scalar blenders
+    enum { N = 150 };
+    GPixel src[N], dst[N], expected[N];
+    uint8_t coverage[N];
+    for (int s = 0; s < 3 * 5; s ++) {
+        GShader::TileMode tile = tiles[s % 3];
+        int kind = s / 3;
+        std::unique_ptr<GShader> shader;
+        if (kind < 2) {
+            shader = GCreateBitmapShader(kind ? translucent : opaque, GMatrix::Scale(0.5f, 0.5f), tile);
+        } else {
+            // 1, 2 and 4 colors, across a span that tiles them a few times
+            int count = kind == 2 ? 1 : kind == 3 ? 2 : 4;
+            shader = GCreateLinearGradient({10, 0}, {60, 20}, colors + (count == 1 ? 1 : 0), count, tile);
+        }
+        shader->setContext(ctm);
+        for (int m = 0; m < GARRAY_COUNT(gScalarBlenders); m ++) {
+            if ((GBlendMode)m == GBlendMode::kDst) continue; // skipped outright, even with coverage
+            GPaint paint(shader.get());
+            paint.setBlendMode((GBlendMode)m);
+            GBlitter blitter(paint);
+            for (int trial = 0; trial < 2; trial ++) {
+                int x = -40 + (int)(rand.nextU() % 80), y = -30 + (int)(rand.nextU() % 60);
+                for (int i = 0; i < N; i ++) {
+                    dst[i] = expected[i] = random_premul_pixel(rand);
+                    coverage[i] = rand.nextU() & 0xFF;
+                }
+                const uint8_t* cov = trial ? coverage : nullptr;
+                shader->shadeRow(x, y, N, src);
+                blend_row_with(nullptr, gScalarBlenders[m], (GBlendMode)m, expected, src, true, cov, N);
+                blitter.blitSpan(x, y, N, dst, cov);
+                // Two colors are mixed with the general formula, which may round differently
+                int tolerance = kind == 3 ? 1 : 0;
+                bool ok = true;
+                for (int i = 0; i < N; i ++) {
+                    for (int shift = 0; shift < 32; shift += 8) {
+                        ok &= std::abs((int)(dst[i] >> shift & 0xFF) - (int)(expected[i] >> shift & 0xFF)) <= tolerance;
+                    }
+                }
+                EXPECT_TRUE(stats, ok);
+            }
+        }
+    }
+    free(opaque.pixels());
+    free(translucent.pixels());
+}
+
+// The texel the scalar shader's tiling picks for the exact coordinate v
+static int tile_texel(GShader::TileMode mode, double v, int size) {
+    double period = mode == GShader::kMirror ? 2.0 * size : size;
+    if (mode != GShader::kClamp) {
+        v -= std::floor(v / period) * period;
+        v += v < 0 ? period : v >= period ? -period : 0;
+    }
+    if (mode == GShader::kMirror && v > size) {
+        v = 2.0 * size - v;
+    }
+    return (int)std::min(std::max(v, 0.0), size - 1.0);
+}
+
+static void test_bitmap_sampling(GTestStats* stats) {
+    GRandom rand;
+    const GShader::TileMode tiles[] = {GShader::kClamp, GShader::kRepeat, GShader::kMirror};
+    // Translated by whole and half pixels, scaled onto and between texel edges and past a
+    // period per block, flipped, rotated
+    const GMatrix matrices[] = {
+        GMatrix::Translate(3, -5),
+        GMatrix::Translate(-20.5f, 7.25f),
+        GMatrix::Scale(2, 2),
+        GMatrix::Scale(0.5f, 0.25f),
+        GMatrix::Scale(7, 0.5f),
+        GMatrix::Concat(GMatrix::Translate(-30, 10), GMatrix::Scale(1.7f, 0.6f)),
+        GMatrix::Scale(-1, 1),
+        GMatrix::Concat(GMatrix::Scale(-3, -3), GMatrix::Translate(0.5f, 0.5f)),
+        GMatrix::Rotate(0.7f),
+        GMatrix::Concat(GMatrix::Scale(0.3f, 2.5f), GMatrix::Rotate(-2)),
+    };
+    enum { N = 100 };
+    GPixel row[N];
+    for (int size = 0; size < 2; size ++) {
+        // Odd sizes wrap by stepping, powers of two by masking
+        GBitmap bitmap;
+        bitmap.alloc(size ? 32 : 37, size ? 16 : 23);
+        for (int y = 0; y < bitmap.height(); y ++) {
+            for (int x = 0; x < bitmap.width(); x ++) {
+                *bitmap.getAddr(x, y) = random_premul_pixel(rand);
+            }
+        }
+        for (GShader::TileMode tile : tiles) {
+            for (const GMatrix& local : matrices) {
+                auto shader = GCreateBitmapShader(bitmap, local, tile);
+                GMatrix ctm;
+                shader->setContext(ctm);
+                bool ok = true;
+                for (int trial = 0; trial < 8; trial ++) {
+                    int x = -60 + (int)(rand.nextU() % 120), y = -60 + (int)(rand.nextU() % 120);
+                    int count = 1 + rand.nextU() % N;
+                    shader->shadeRow(x, y, count, row);
+                    GPoint start = local * GPoint{x + 0.5f, y + 0.5f};
+                    for (int j = 0; j < count; j ++) {
+                        int ix = tile_texel(tile, (double)start.fX + (double)local[0] * j, bitmap.width());
+                        int iy = tile_texel(tile, (double)start.fY + (double)local[3] * j, bitmap.height());
+                        ok &= row[j] == *bitmap.getAddr(ix, iy);
+                    }
+                }
+                EXPECT_TRUE(stats, ok);
+            }
+        }
+        free(bitmap.pixels());
+    }
+}
@@ -34,6 +34,7 @@ private:
 #include "tests_pa3.cpp"
 #include "tests_pa4.cpp"
 #include "tests_pa5.cpp"
+#include "tests_perf.cpp"
 
 const GTestRec gTestRecs[] = {
     { test_clear,       "clear"         },
@@ -58,6 +59,32 @@ const GTestRec gTestRecs[] = {
     { test_path_chop_quad,   "path_chop_quad"    },
     { test_path_chop_cubic,   "path_chop_cubic"    },
 
+    { test_rotated_polygon_matches_expected, "rotated_polygon_matches_expected" },
+    { test_aa_rect_coverage, "aa_rect_coverage" },
+    { test_aa_path_winding,  "aa_path_winding"  },
+    { test_tiled_matches_serial, "tiled_matches_serial" },
+    { test_picture_matches_direct, "picture_matches_direct" },
+    { test_picture_culls_ops, "picture_culls_ops" },
+    { test_picture_batch_cache, "picture_batch_cache" },
+    { test_path_bounds_and_guard_band, "path_bounds_and_guard_band" },
+    { test_path_edge_cache, "path_edge_cache" },
+    { test_active_edge_table_many_edges, "active_edge_table_many_edges" },
+    { test_mesh_plane_colors, "mesh_plane_colors" },
+    { test_quad_streaming_matches_grid, "quad_streaming_matches_grid" },
+    { test_quad_auto_level, "quad_auto_level" },
+    { test_clip_rect, "clip_rect" },
+    { test_clip_path_mask, "clip_path_mask" },
+    { test_picture_records_clips, "picture_records_clips" },
+    { test_damage_tracker, "damage_tracker" },
+    { test_cull_occluded, "cull_occluded" },
+    { test_cull_by_shader_opacity, "cull_by_shader_opacity" },
+    { test_blend_row_simd, "blend_row_simd" },
+    { test_blend_reduction, "blend_reduction" },
+    { test_solid_fill, "solid_fill" },
+    { test_two_color_gradient_row, "two_color_gradient_row" },
+    { test_raster_pipeline, "raster_pipeline" },
+    { test_bitmap_sampling, "bitmap_sampling" },
+
     { nullptr, nullptr },
 };
 
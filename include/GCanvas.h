@@ -14,12 +14,21 @@ class GPath;
 class GPoint;
 class GRect;
 
+/**
+ *  Activity of a canvas's path edge cache since the canvas was made.
+ */
+struct GPathCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    int      entries;
+};
+
 class GCanvas {
 public:
     virtual ~GCanvas() {}
 
     /**
-     *  Save off a copy of the canvas state (CTM), to be later used if the balancing call to
+     *  Save off a copy of the canvas state (CTM and clip), to be later used if the balancing call to
      *  restore() is made. Calls to save/restore can be nested:
      *  save();
      *      save();
@@ -32,7 +41,7 @@ public:
     virtual void save() = 0;
 
     /**
-     *  Copy the canvas state (CTM) that was record in the correspnding call to save() back into
+     *  Copy the canvas state (CTM and clip) that was record in the correspnding call to save() back into
      *  the canvas. It is an error to call restore() if there has been no previous call to save().
      */
     virtual void restore() = 0;
@@ -45,6 +54,19 @@ public:
      */
     virtual void concat(const GMatrix& matrix) = 0;
 
+    /**
+     *  Intersect the clip with the rectangle, transformed by the CTM. Like the CTM, the clip is
+     *  saved and restored by save() and restore(). No draw changes a pixel outside the clip.
+     *  A pixel is inside the rectangle if its center is, the same as for drawRect.
+     */
+    virtual void clipRect(const GRect&) = 0;
+
+    /**
+     *  Intersect the clip with the path (non-zero winding), transformed by the CTM. If antiAlias
+     *  is true, pixels along the path's edge are drawn scaled by how much of them it covers.
+     */
+    virtual void clipPath(const GPath&, bool antiAlias) = 0;
+
     /**
      *  Fill the entire canvas with the specified color, using the specified blendmode.
      */
@@ -122,6 +144,29 @@ public:
     virtual void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
                           int level, const GPaint&) = 0;
 
+    /**
+     *  Same as drawQuad, but the level is picked from the quad's size and shape on the device:
+     *  just enough subdivision that the triangles stay within maxError pixels of the true
+     *  (bilinearly interpolated) quad. Quads that are small or nearly flat on the device collapse
+     *  to 2 triangles. Colors count their error in 8-bit steps against the same budget.
+     */
+    virtual void drawQuadAuto(const GPoint verts[4], const GColor colors[4], const GPoint texs[4],
+                              float maxError, const GPaint&) = 0;
+
+    /**
+     *  drawPath may keep the edges it builds in an LRU cache owned by the canvas, keyed by the
+     *  path's generation ID and the CTM, so redrawing a path under the same CTM skips flattening
+     *  and clipping. A path's edges are only kept once it has missed twice lately. Canvases
+     *  without a cache report all zeros.
+     */
+    virtual GPathCacheStats getPathCacheStats() const { return {0, 0, 0}; }
+
+    /**
+     *  Set how many edge lists the cache keeps, separately for aliased and anti-aliased edges.
+     *  0 disables caching.
+     */
+    virtual void setPathCacheLimit(int) {}
+
     // Helpers
 
     void translate(float x, float y) {
@@ -153,6 +198,18 @@ public:
  */
 std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap);
 
+/**
+ *  Same as above, but the canvas rasterizes with threadCount threads: the device is split into
+ *  fixed-size tiles which are filled in parallel. The resulting pixels are identical to those of
+ *  the single-threaded canvas. Returns NULL if threadCount < 1.
+ *
+ *  A draw sets its paint's shader's context once, on the calling thread, and then the tiles
+ *  call shadeRow on that one shader from several threads at once. shadeRow must therefore
+ *  only read the shader, as the shaders here do. Textured meshes set a new context for each
+ *  triangle, only once the tiles of the triangle before it are done.
+ */
+std::unique_ptr<GCanvas> GCreateCanvas(const GBitmap& bitmap, int threadCount);
+
 /**
  *  Implement this, drawing into the provided canvas, and returning the title of your artwork.
  */
@@ -1,6 +1,7 @@
 #ifndef GPath_DEFINED
 #define GPath_DEFINED
 
+#include <atomic>
 #include <vector>
 #include "GMatrix.h"
 #include "GPoint.h"
@@ -9,6 +10,7 @@
 class GPath {
 public:
     GPath();
+    GPath(const GPath&);
     ~GPath();
 
     GPath& operator=(const GPath&);
@@ -25,6 +27,7 @@ public:
     GPath& moveTo(GPoint p) {
         fPts.push_back(p);
         fVbs.push_back(kMove);
+        this->changed();
         return *this;
     }
     GPath& moveTo(float x, float y) { return this->moveTo({x, y}); }
@@ -38,6 +41,7 @@ public:
         assert(fVbs.size() > 0);
         fPts.push_back(p);
         fVbs.push_back(kLine);
+        this->changed();
         return *this;
     }
     GPath& lineTo(float x, float y) { return this->lineTo({x, y}); }
@@ -87,6 +91,13 @@ public:
 
     int countPoints() const { return (int)fPts.size(); }
 
+    /**
+     *  Return an ID that changes whenever the path's points or verbs change. Copies of a path
+     *  share its ID until one of them is modified, so equal IDs mean equal contents.
+     *  IDs are 64-bit and only taken when asked for after a change, so they never repeat.
+     */
+    uint64_t getGenerationID() const;
+
     /**
      *  Return the bounds of all of the control-points in the path.
      *
@@ -191,6 +202,10 @@ public:
 private:
     std::vector<GPoint> fPts;
     std::vector<Verb>   fVbs;
+    mutable std::atomic<uint64_t> fGenID; // 0 until asked for since the last change
+
+    // Drop the path's generation ID; Called by every method that modifies it
+    void changed() { fGenID.store(0, std::memory_order_relaxed); }
 };
 
 #endif
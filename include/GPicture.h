@@ -0,0 +1,126 @@
+#ifndef GPicture_DEFINED
+#define GPicture_DEFINED
+
+#include "GCanvas.h"
+#include "GRect.h"
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+/**
+ *  What GPicture::cullOccluded() took out of a picture.
+ */
+struct GOcclusionStats {
+    int opsDropped = 0;         // ops entirely hidden by later opaque ops
+    int opsClipped = 0;         // ops clipped to the part that is not hidden
+    int64_t pixelsSaved = 0;    // area of the op bounds that is no longer drawn
+};
+
+/**
+ *  An immutable recording of draw calls (a display list). Each recorded op keeps its CTM, its
+ *  paint, its clip, and its bounds in the recording's device space (clipped).
+ *
+ *  A picture is never modified after it is recorded, so several threads may play back the same
+ *  picture at once. Note that paints keep their GShader* as-is: the caller must keep shaders
+ *  alive while the picture is in use, and shaders are stateful (setContext), so ops using the
+ *  same shader must not be played back concurrently.
+ */
+class GPicture {
+public:
+    virtual ~GPicture() {}
+
+    /**
+     *  Union of the device bounds of all ops, in the recording's device space.
+     */
+    virtual GIRect bounds() const = 0;
+
+    virtual int countOps() const = 0;
+
+    /**
+     *  Replay the ops onto the canvas, under the canvas' current CTM. Ops whose bounds do not
+     *  intersect target (in the recording's device space) are skipped. Runs of adjacent ops that
+     *  share a paint and CTM and do not touch each other's pixels are merged into one path when
+     *  the picture is made, and drawn as that path when the whole run intersects target.
+     */
+    virtual void playback(GCanvas* canvas, const GIRect& target) const = 0;
+
+    void playback(GCanvas* canvas) const {
+        this->playback(canvas, this->bounds());
+    }
+
+    /**
+     *  Return a copy of this picture without the ops that later opaque ops completely cover,
+     *  and with ops that are mostly covered clipped to the rest.
+     *
+     *  An op hides what is under it if it fills a rect or the whole clip, under a scale and
+     *  translate CTM and rect clips, and either uses kSrc or kClear, or uses kSrcOver with an
+     *  opaque color or a shader whose isOpaque() is true. Coverage is tracked per 16x16 tile of
+     *  the recording. The copy draws the same pixels when played back without scale or rotation.
+     *
+     *  @param stats If not null, receives what was culled.
+     */
+    virtual std::shared_ptr<const GPicture> cullOccluded(GOcclusionStats* stats = nullptr) const = 0;
+};
+
+/**
+ *  A canvas that records the calls made on it instead of drawing pixels.
+ */
+class GRecordingCanvas : public GCanvas {
+public:
+    /**
+     *  Return the picture of everything recorded so far, and reset the recorder to empty.
+     */
+    virtual std::shared_ptr<const GPicture> finishRecording() = 0;
+};
+
+/**
+ *  Return a recording canvas whose device space is [0, 0, size.width, size.height]; Op bounds
+ *  are clipped to it, and ops falling entirely outside it are not recorded.
+ */
+std::unique_ptr<GRecordingCanvas> GCreateRecordingCanvas(GISize size);
+
+/**
+ *  Draws a sequence of frames into one persistent canvas, redrawing only what changed.
+ *
+ *  Each frame is a picture of the whole scene, and is compared op by op, in order, with the
+ *  previous one: where two ops differ, the bounds of both are damaged, as are the bounds of ops
+ *  only one of the frames has. The damage is kept as a few dirty rects, and the frame is played
+ *  back clipped to each of them; Every other pixel already holds what this frame would draw.
+ *
+ *  Since a dirty rect is redrawn on top of the previous frame, each frame must cover its pixels
+ *  opaquely (e.g. start with an opaque drawPaint). Shaders are compared by pointer, so a shader
+ *  must not be changed while a frame that uses it may still be compared.
+ */
+class GDamageTracker {
+public:
+    /**
+     *  @param maxRects Most dirty rects per frame; Beyond that the closest ones are merged.
+     */
+    explicit GDamageTracker(int maxRects = 8) : fMaxRects(maxRects) {}
+
+    /**
+     *  Draw frame onto canvas, which must have an identity CTM and no clip, and hold the previous
+     *  frame drawn by this tracker. The first frame (and the first after reset) is drawn whole,
+     *  over the frame's recording size. Returns the rects that were redrawn.
+     */
+    const std::vector<GIRect>& draw(std::shared_ptr<const GPicture> frame, GCanvas* canvas);
+
+    /**
+     *  Forget the previous frame, e.g. when the canvas' pixels were changed by someone else.
+     */
+    void reset() { fPrevious.reset(); }
+
+    /**
+     *  Number of pixels in the rects redrawn by the last draw().
+     */
+    int64_t pixelsRedrawn() const;
+
+private:
+    std::shared_ptr<const GPicture> fPrevious;
+    std::vector<GIRect> fDirty;
+    int fMaxRects;
+
+    void addDirty(GIRect rect);
+};
+
+#endif
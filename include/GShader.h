@@ -12,6 +12,7 @@
 
 class GBitmap;
 class GMatrix;
+class GRasterPipeline;
 
 /**
  *  GShaders create colors to fill whatever geometry is being drawn to a GCanvas.
@@ -38,6 +39,13 @@ public:
      *  can hold at least [count] entries.
      */
     virtual void shadeRow(int x, int y, int count, GPixel row[]) = 0;
+
+    /**
+     *  Append the stages that compute the same pixels as shadeRow to the pipeline, after
+     *  setContext. Return false, leaving the pipeline as it was, if there are none; The
+     *  pipeline then calls shadeRow.
+     */
+    virtual bool appendStages(GRasterPipeline*) { return false; }
 };
 
 /**
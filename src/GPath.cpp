@@ -4,14 +4,19 @@
 
 #include "../include/GPath.h"
 #include "../include/GMatrix.h"
+#include <atomic>
 
-GPath::GPath() {}
+static std::atomic<uint64_t> gNextGenID(1);
+
+GPath::GPath() : fGenID(0) {}
+GPath::GPath(const GPath& src) : fPts(src.fPts), fVbs(src.fVbs), fGenID(src.getGenerationID()) {}
 GPath::~GPath() {}
 
 GPath& GPath::operator=(const GPath& src) {
     if (this != &src) {
         fPts = src.fPts;
         fVbs = src.fVbs;
+        fGenID.store(src.getGenerationID(), std::memory_order_relaxed);
     }
     return *this;
 }
@@ -19,9 +24,22 @@ GPath& GPath::operator=(const GPath& src) {
 GPath& GPath::reset() {
     fPts.clear();
     fVbs.clear();
+    this->changed();
     return *this;
 }
 
+uint64_t GPath::getGenerationID() const {
+    uint64_t id = fGenID.load(std::memory_order_relaxed);
+    if (id == 0) {
+        // Another thread may be asking too; Whichever stores first wins, and both return its ID
+        uint64_t next = gNextGenID.fetch_add(1, std::memory_order_relaxed);
+        if (fGenID.compare_exchange_strong(id, next, std::memory_order_relaxed)) {
+            id = next;
+        }
+    }
+    return id;
+}
+
 void GPath::dump() const {
     Iter iter(*this);
     GPoint pts[GPath::kMaxNextPoints];
@@ -52,6 +70,7 @@ GPath& GPath::quadTo(GPoint p1, GPoint p2) {
     fPts.push_back(p1);
     fPts.push_back(p2);
     fVbs.push_back(kQuad);
+    this->changed();
     return *this;
 }
 
@@ -61,6 +80,7 @@ GPath& GPath::cubicTo(GPoint p1, GPoint p2, GPoint p3) {
     fPts.push_back(p2);
     fPts.push_back(p3);
     fVbs.push_back(kCubic);
+    this->changed();
     return *this;
 }
 